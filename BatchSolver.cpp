@@ -0,0 +1,90 @@
+#include "BatchSolver.h"
+#include <atomic>
+
+//this file handles solving a whole batch of independent series at once
+
+BatchSolver::BatchSolver(int threads, double newPenalty, Grid::SolverType newSolver) {
+	if (threads < 1) threads = 1;
+	penalty = newPenalty;
+	solver = newSolver;
+	pool = (threads > 1) ? make_shared<ThreadPool>(threads) : nullptr;
+	workers.resize(threads);
+	for (unsigned int i = 0; i < workers.size(); i++) workers[i].grid.SetPenalty(penalty);
+}
+
+//solve every series of a batch held back to back in one array: series s is points[seriesOffsets[s]] up to points[seriesOffsets[s + 1]]
+void BatchSolver::Solve(const Grid::point* points, const size_t* seriesOffsets, int numSeries, batchPartitions& result) {
+	result.lineOffsets.assign(static_cast<size_t>(max(numSeries, 0)) + 1, 0);
+	result.lines.clear();
+	if (numSeries <= 0) return;
+	int threads = static_cast<int>(workers.size());
+	//small enough batches of series that the threads still even out at the end, big enough that the counter isn't fought over
+	int claimSize = max(1, min(64, numSeries / (threads * 16)));
+	atomic<int> nextSeries(0);
+	function<void(int)> solveClaimed = [&](int t) {
+		batchWorker& worker = workers[t];
+		worker.series.clear();
+		worker.lines.clear();
+		for (int first = nextSeries.fetch_add(claimSize); first < numSeries; first = nextSeries.fetch_add(claimSize)) {
+			int last = min(numSeries, first + claimSize);
+			for (int s = first; s < last; s++) {
+				worker.series.push_back(s);
+				//each series is only ever solved by one thread, so its slot in lineOffsets can be written without a lock
+				SolveSeries(worker, points + seriesOffsets[s], points + seriesOffsets[s + 1], result.lineOffsets[s + 1]);
+			}
+		}
+	};
+	if (pool) pool->Run(threads, solveClaimed);
+	else solveClaimed(0);
+
+	//turn the line counts into offsets, then every thread copies its own series' lines into place
+	for (int s = 0; s < numSeries; s++) result.lineOffsets[s + 1] += result.lineOffsets[s];
+	result.lines.resize(result.lineOffsets[numSeries]);
+	function<void(int)> copyLines = [&](int t) {
+		const batchWorker& worker = workers[t];
+		size_t read = 0;
+		for (unsigned int i = 0; i < worker.series.size(); i++) {
+			int s = worker.series[i];
+			size_t count = result.lineOffsets[s + 1] - result.lineOffsets[s];
+			copy(worker.lines.begin() + read, worker.lines.begin() + read + count, result.lines.begin() + result.lineOffsets[s]);
+			read += count;
+		}
+	};
+	if (pool) pool->Run(threads, copyLines);
+	else copyLines(0);
+}
+
+//same as above for series given as separate vectors
+void BatchSolver::Solve(const vector<vector<Grid::point>>& series, batchPartitions& result) {
+	vector<Grid::point> points;
+	vector<size_t> seriesOffsets(1, 0);
+	for (unsigned int s = 0; s < series.size(); s++) seriesOffsets.push_back(seriesOffsets.back() + series[s].size());
+	points.reserve(seriesOffsets.back());
+	for (unsigned int s = 0; s < series.size(); s++) points.insert(points.end(), series[s].begin(), series[s].end());
+	Solve(points.data(), seriesOffsets.data(), static_cast<int>(series.size()), result);
+}
+
+//load one series into the worker's grid in place of the last one and solve it, leaving its division lines on the end of worker.lines
+//the points go in sorted by (x, y) without duplicates, just as AddPoints would leave them in an empty grid - the grid is private
+//to this solver, so its duplicate check index is left empty rather than rebuilt for every series
+void BatchSolver::SolveSeries(batchWorker& worker, const Grid::point* first, const Grid::point* last, size_t& numLines) {
+	vector<Grid::point>& points = worker.grid.points;
+	points.assign(first, last);
+	sort(points.begin(), points.end(), [](const Grid::point& a, const Grid::point& b) { return (a.x != b.x) ? a.x < b.x : a.y < b.y; });
+	points.erase(unique(points.begin(), points.end()), points.end());
+	const vector<int>& lines = worker.grid.FindOptimalPartitionLines(solver);
+	worker.lines.insert(worker.lines.end(), lines.begin(), lines.end());
+	numLines = lines.size();
+}
+
+int BatchSolver::GetThreadCount() {
+	return static_cast<int>(workers.size());
+}
+
+double BatchSolver::GetPenalty() {
+	return penalty;
+}
+
+Grid::SolverType BatchSolver::GetSolverType() {
+	return solver;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "Grid.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+//division lines for every series of a batch, all in one buffer: the lines of series s are lines[lineOffsets[s]] up to (not including)
+//lines[lineOffsets[s + 1]], so a batch of any size comes back as two allocations instead of one list per series
+struct batchPartitions {
+	vector<size_t> lineOffsets;
+	vector<int> lines;
+};
+
+//solves many independent point sets (series) with the same penalty and solver, spread over a pool of threads
+//each thread keeps one Grid for the whole life of the solver and reuses it, arena and all, for every series it picks up, so after
+//the first few series a batch doesn't allocate per series; series are claimed a few at a time from a shared counter, so a thread
+//that finishes early just takes more of them
+//every series gets the same partitioning as a fresh Grid given its points through AddPoints
+class BatchSolver {
+
+	//one thread's grid, and the series it solved in the current batch with their division lines back to back
+	struct batchWorker {
+		Grid grid;
+		vector<int> series;
+		vector<int> lines;
+	};
+
+	void SolveSeries(batchWorker& worker, const Grid::point* first, const Grid::point* last, size_t& numLines);
+	shared_ptr<ThreadPool> pool;
+	vector<batchWorker> workers;
+	double penalty;
+	Grid::SolverType solver;
+
+public:
+	BatchSolver(int threads = 1, double newPenalty = 10.0, Grid::SolverType newSolver = Grid::SolverType::Tabulation);
+	void Solve(const Grid::point* points, const size_t* seriesOffsets, int numSeries, batchPartitions& result);
+	void Solve(const vector<vector<Grid::point>>& series, batchPartitions& result);
+	int GetThreadCount();
+	double GetPenalty();
+	Grid::SolverType GetSolverType();
+
+};
@@ -0,0 +1,266 @@
+//Non-interactive benchmark for the partitioning solvers in Grid.cpp
+//Generates a reproducible (seeded) point set, times each requested solver a number of times, and prints one CSV row or JSON object
+//per solver with the median and 95th percentile times, throughput and memory use, so runs can be compared between versions.
+//solver_rss_kb is how far the solver pushed peak resident memory above what the loaded point set already held. each solver runs in
+//its own forked process that starts from the loaded grid, so no solver's buffers or peak show up in another's row (on Windows,
+//which can't fork, the solvers share one process, and a solver that peaks lower than an earlier one reports 0)
+//
+//usage: Benchmark [--n 5000] [--m 5000] [--penalty 10] [--solver tabulation,pruned] [--reps 10] [--shape uniform] [--seed 1]
+//                 [--changepoints 20] [--threads 1] [--format csv]
+//solvers: tabulation, memoization, pruned, binned, parallel (comma separated, or "all")
+//shapes:  uniform     - x uniform in [1,m], y uniform in [-m,m] (the same shape as Grid::AddRandomPoints)
+//         steps       - piecewise constant y with --changepoints planted changepoints plus near gaussian unit noise
+//         collisions  - x drawn from only sqrt(m) distinct values, so most points share an x with many others ("duplicates" also works)
+//the points come from PointGenerator (PointGenerator.cpp), made on --threads threads
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include "Grid.h"
+#include "PointGenerator.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+struct benchmarkOptions {
+    int numPoints = 5000;
+    int maxX = 5000;
+    double penalty = 10.0;
+    vector<string> solvers = { "tabulation" };
+    int repetitions = 10;
+    string shape = "uniform";
+    unsigned long long seed = 1;
+    int changepoints = 20;
+    int threads = 1;
+    string format = "csv";
+};
+
+struct benchmarkResult {
+    string solver;
+    double median;
+    double percentile95;
+    double pointsPerSecond;
+    long long solverMemoryKB;
+    int intervals;
+};
+
+bool parseOptions(int argc, char* argv[], benchmarkOptions& options);
+bool solverFromName(const string& name, Grid::SolverType& solver);
+vector<Grid::point> generatePoints(const benchmarkOptions& options);
+benchmarkResult runSolver(Grid& grid, const string& name, const benchmarkOptions& options);
+benchmarkResult runSolverIsolated(Grid& grid, const string& name, const benchmarkOptions& options);
+long long peakMemoryKB();
+void printResults(const benchmarkOptions& options, int numPoints, const vector<benchmarkResult>& results);
+
+int main(int argc, char* argv[]) {
+    benchmarkOptions options;
+    if (!parseOptions(argc, argv, options)) return 1;
+
+    Grid grid = Grid();
+    grid.SetPenalty(options.penalty);
+    grid.AddPoints(generatePoints(options));
+
+    vector<benchmarkResult> results;
+    for (unsigned int i = 0; i < options.solvers.size(); i++) results.push_back(runSolverIsolated(grid, options.solvers[i], options));
+    printResults(options, grid.GetNumPoints(), results);
+    return 0;
+}
+
+//read "--name value" pairs from the command line, complaining about anything unknown or out of range
+bool parseOptions(int argc, char* argv[], benchmarkOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        string name = argv[i];
+        if (name == "--help" || name == "-h" || i + 1 >= argc) {
+            cerr << "usage: Benchmark [--n points] [--m maxX] [--penalty p] [--solver list|all] [--reps r] [--shape uniform|steps|collisions]"
+                << " [--seed s] [--changepoints c] [--threads t] [--format csv|json]" << endl;
+            return false;
+        }
+        string value = argv[++i];
+        //the numeric options have to be a whole number in range - stoi and friends throw otherwise, and stop quietly at trailing junk
+        size_t used = value.size(); bool numeric = true;
+        try {
+            if (name == "--n") options.numPoints = stoi(value, &used);
+            else if (name == "--m") options.maxX = stoi(value, &used);
+            else if (name == "--penalty") options.penalty = stod(value, &used);
+            else if (name == "--reps") options.repetitions = stoi(value, &used);
+            else if (name == "--seed") options.seed = stoull(value, &used);
+            else if (name == "--changepoints") options.changepoints = stoi(value, &used);
+            else if (name == "--threads") options.threads = stoi(value, &used);
+            else numeric = false;
+        }
+        catch (const logic_error&) {
+            used = 0;
+        }
+        if (used != value.size()) {
+            cerr << "Bad value " << value << " for " << name << endl;
+            return false;
+        }
+        if (numeric) continue;
+        if (name == "--shape") options.shape = value;
+        else if (name == "--format") options.format = value;
+        else if (name == "--solver") {
+            options.solvers.clear();
+            if (value == "all") options.solvers = { "tabulation", "memoization", "pruned", "binned", "parallel" };
+            else {
+                stringstream ss(value); string piece;
+                while (getline(ss, piece, ',')) options.solvers.push_back(piece);
+            }
+        }
+        else {
+            cerr << "Unknown option " << name << endl;
+            return false;
+        }
+    }
+    Grid::SolverType solver;
+    for (unsigned int i = 0; i < options.solvers.size(); i++) {
+        if (!solverFromName(options.solvers[i], solver)) {
+            cerr << "Unknown solver " << options.solvers[i] << endl;
+            return false;
+        }
+    }
+    if (options.numPoints < 0 || options.maxX < 1 || options.repetitions < 1 || options.changepoints < 0 || options.threads < 1) {
+        cerr << "Options must be positive (n and changepoints may be 0)." << endl;
+        return false;
+    }
+    if (options.shape != "uniform" && options.shape != "steps" && options.shape != "duplicates" && options.shape != "collisions") {
+        cerr << "Unknown shape " << options.shape << endl;
+        return false;
+    }
+    if (options.format != "csv" && options.format != "json") {
+        cerr << "Unknown format " << options.format << endl;
+        return false;
+    }
+    return true;
+}
+
+bool solverFromName(const string& name, Grid::SolverType& solver) {
+    if (name == "tabulation") solver = Grid::SolverType::Tabulation;
+    else if (name == "memoization") solver = Grid::SolverType::Memoization;
+    else if (name == "pruned") solver = Grid::SolverType::Pruned;
+    else if (name == "binned") solver = Grid::SolverType::Binned;
+    else if (name == "parallel") solver = Grid::SolverType::ParallelTabulation;
+    else return false;
+    return true;
+}
+
+//build the point set for the chosen shape with the counter based PointGenerator - the same options and seed always give the same
+//points, whatever the thread count
+vector<Grid::point> generatePoints(const benchmarkOptions& options) {
+    PointGenerator::Shape shape = PointGenerator::Shape::Uniform;
+    if (options.shape == "steps") shape = PointGenerator::Shape::Steps;
+    else if (options.shape == "duplicates" || options.shape == "collisions") shape = PointGenerator::Shape::Collisions;
+    PointGenerator generator(options.seed, shape, options.maxX, options.changepoints);
+    return generator.Generate(static_cast<size_t>(max(options.numPoints, 0)), options.threads);
+}
+
+//time one solver over every repetition and summarise
+benchmarkResult runSolver(Grid& grid, const string& name, const benchmarkOptions& options) {
+    Grid::SolverType solver = Grid::SolverType::Tabulation;
+    solverFromName(name, solver);
+    long long peakBefore = peakMemoryKB();
+    vector<double> times;
+    for (int i = 0; i < options.repetitions; i++) times.push_back(grid.TimeToFindDivisions(solver));
+    sort(times.begin(), times.end());
+    benchmarkResult result;
+    result.solver = name;
+    result.median = (times.size() % 2 == 1) ? times[times.size() / 2] : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+    result.percentile95 = times[min(times.size() - 1, static_cast<size_t>(ceil(0.95 * times.size())) - 1)];
+    result.pointsPerSecond = (result.median > 0) ? grid.GetNumPoints() / result.median : 0;
+    result.intervals = static_cast<int>(grid.FindOptimalPartitionLines(solver).size()) + 1;
+    result.solverMemoryKB = peakMemoryKB() - peakBefore;
+    return result;
+}
+
+//run one solver in a child process forked from the loaded grid, so its memory is measured on its own (see the top of the file)
+//a forked child starts its peak at the resident memory it shares with the parent, not at the parent's earlier peaks, and the
+//parent never solves, so every child starts with empty solver buffers. the grid's thread pool is made in the child, as a fork
+//only copies the thread that calls it
+benchmarkResult runSolverIsolated(Grid& grid, const string& name, const benchmarkOptions& options) {
+#ifndef _WIN32
+    int channel[2];
+    cout.flush();
+    if (pipe(channel) == 0) {
+        pid_t child = fork();
+        if (child == 0) {
+            close(channel[0]);
+            grid.SetThreadCount(options.threads);
+            benchmarkResult result = runSolver(grid, name, options);
+            double values[5] = { result.median, result.percentile95, result.pointsPerSecond, static_cast<double>(result.solverMemoryKB),
+                static_cast<double>(result.intervals) };
+            ssize_t written = write(channel[1], values, sizeof(values));
+            _exit((written == static_cast<ssize_t>(sizeof(values))) ? 0 : 1);
+        }
+        close(channel[1]);
+        double values[5] = {};
+        size_t received = 0;
+        while (child > 0 && received < sizeof(values)) {
+            ssize_t count = read(channel[0], reinterpret_cast<char*>(values) + received, sizeof(values) - received);
+            if (count <= 0) break;
+            received += static_cast<size_t>(count);
+        }
+        close(channel[0]);
+        int status = 0;
+        if (child > 0) waitpid(child, &status, 0);
+        if (received == sizeof(values)) {
+            benchmarkResult result;
+            result.solver = name;
+            result.median = values[0];
+            result.percentile95 = values[1];
+            result.pointsPerSecond = values[2];
+            result.solverMemoryKB = static_cast<long long>(values[3]);
+            result.intervals = static_cast<int>(values[4]);
+            return result;
+        }
+    }
+    cerr << "Could not run " << name << " in its own process - running it here, its memory may include earlier solvers'" << endl;
+#endif
+    grid.SetThreadCount(options.threads);
+    return runSolver(grid, name, options);
+}
+
+//peak resident set size of this process so far, in kilobytes
+long long peakMemoryKB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return static_cast<long long>(counters.PeakWorkingSetSize / 1024);
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<long long>(usage.ru_maxrss / 1024);
+#else
+    return static_cast<long long>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+void printResults(const benchmarkOptions& options, int numPoints, const vector<benchmarkResult>& results) {
+    cout << setprecision(9);
+    if (options.format == "csv") {
+        cout << "solver,shape,n,m,penalty,threads,reps,seed,median_s,p95_s,points_per_s,solver_rss_kb,intervals" << endl;
+        for (unsigned int i = 0; i < results.size(); i++) {
+            cout << results[i].solver << "," << options.shape << "," << numPoints << "," << options.maxX << "," << options.penalty << ","
+                << options.threads << "," << options.repetitions << "," << options.seed << "," << results[i].median << ","
+                << results[i].percentile95 << "," << results[i].pointsPerSecond << "," << results[i].solverMemoryKB << "," << results[i].intervals << endl;
+        }
+        return;
+    }
+    cout << "[" << endl;
+    for (unsigned int i = 0; i < results.size(); i++) {
+        cout << "  {\"solver\": \"" << results[i].solver << "\", \"shape\": \"" << options.shape << "\", \"n\": " << numPoints
+            << ", \"m\": " << options.maxX << ", \"penalty\": " << options.penalty << ", \"threads\": " << options.threads
+            << ", \"reps\": " << options.repetitions << ", \"seed\": " << options.seed << ", \"median_s\": " << results[i].median
+            << ", \"p95_s\": " << results[i].percentile95 << ", \"points_per_s\": " << results[i].pointsPerSecond
+            << ", \"solver_rss_kb\": " << results[i].solverMemoryKB << ", \"intervals\": " << results[i].intervals << "}"
+            << ((i + 1 < results.size()) ? "," : "") << endl;
+    }
+    cout << "]" << endl;
+}
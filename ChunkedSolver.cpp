@@ -0,0 +1,183 @@
+#include "ChunkedSolver.h"
+#include "PiecewiseModel.h"
+#include <atomic>
+
+//this file handles solving point files too big for memory, one chunk at a time
+
+ChunkedSolver::ChunkedSolver(int threads, double newPenalty, size_t newChunkSize, int newStitchSegments) {
+	if (threads < 1) threads = 1;
+	penalty = newPenalty;
+	chunkSize = max(newChunkSize, static_cast<size_t>(1));
+	stitchSegments = max(newStitchSegments, 1);
+	pool = (threads > 1) ? make_shared<ThreadPool>(threads) : nullptr;
+	workers.resize(threads);
+	for (unsigned int i = 0; i < workers.size(); i++) workers[i].grid.SetPenalty(penalty);
+}
+
+//solve the point file at path (see PointFile.h) - returns false (see GetError) if it can't be read or holds invalid points
+bool ChunkedSolver::Solve(const string& path, chunkedPartitioning& result) {
+	result = { vector<int>(), 0.0, 0.0, 0, 0 };
+	for (unsigned int t = 0; t < workers.size(); t++) {
+		if (!workers[t].reader.Open(path)) {
+			error = workers[t].reader.GetError();
+			return false;
+		}
+	}
+	vector<size_t> chunkStarts;
+	if (!PlanChunks(workers[0].reader, chunkStarts)) return false;
+	int numChunks = static_cast<int>(chunkStarts.size()) - 1;
+	size_t numPoints = chunkStarts.back();
+	if (numChunks == 0) {
+		error.clear();
+		return true;
+	}
+
+	//solve every chunk on its own - the sum of their optimal costs is the lower bound
+	vector<vector<segment>> chunkSegments(numChunks);
+	if (!RunOnWorkers(numChunks, [&](chunkWorker& worker, int c) { return SolveRange(worker, chunkStarts[c], chunkStarts[c + 1], chunkSegments[c]); }))
+		return false;
+	vector<segment> segments;
+	vector<size_t> chunkFirstSegment(numChunks + 1, 0);
+	for (int c = 0; c < numChunks; c++) {
+		chunkFirstSegment[c] = segments.size();
+		for (unsigned int s = 0; s < chunkSegments[c].size(); s++) result.lowerBound += chunkSegments[c][s].error;
+		result.lowerBound += penalty * (chunkSegments[c].size() - 1);
+		segments.insert(segments.end(), chunkSegments[c].begin(), chunkSegments[c].end());
+		chunkSegments[c] = vector<segment>();
+	}
+	chunkFirstSegment[numChunks] = segments.size();
+
+	//one window of segments [first, last) around every seam that can be stitched, none of them overlapping
+	vector<pair<size_t, size_t>> windows;
+	size_t previousEnd = 0;
+	for (int c = 1; c < numChunks; c++) {
+		size_t seam = chunkFirstSegment[c];
+		size_t first = max(seam - min(static_cast<size_t>(stitchSegments), seam - chunkFirstSegment[c - 1]), previousEnd);
+		if (first >= seam) {
+			result.seams++;
+			continue;
+		}
+		previousEnd = seam + min(static_cast<size_t>(stitchSegments), chunkFirstSegment[c + 1] - seam);
+		windows.push_back({ first, previousEnd });
+	}
+	vector<vector<segment>> windowSegments(windows.size());
+	bool solved = RunOnWorkers(static_cast<int>(windows.size()), [&](chunkWorker& worker, int w) {
+		size_t firstPoint = segments[windows[w].first].first;
+		size_t lastPoint = (windows[w].second < segments.size()) ? segments[windows[w].second].first : numPoints;
+		return SolveRange(worker, firstPoint, lastPoint, windowSegments[w]);
+	});
+	if (!solved) return false;
+
+	//swap every window's segments for its new partitioning, then total up the cost of the result
+	vector<segment> stitched;
+	stitched.reserve(segments.size());
+	size_t next = 0;
+	for (unsigned int w = 0; w < windows.size(); w++) {
+		stitched.insert(stitched.end(), segments.begin() + next, segments.begin() + windows[w].first);
+		stitched.insert(stitched.end(), windowSegments[w].begin(), windowSegments[w].end());
+		next = windows[w].second;
+	}
+	stitched.insert(stitched.end(), segments.begin() + next, segments.end());
+	for (unsigned int s = 0; s < stitched.size(); s++) {
+		result.cost += stitched[s].error;
+		if (s > 0) result.partitionLines.push_back(stitched[s].x);
+	}
+	result.cost += penalty * (stitched.size() - 1);
+	result.lowerBound = min(result.lowerBound, result.cost);
+	result.chunks = numChunks;
+	error.clear();
+	return true;
+}
+
+//find where each chunk starts: every chunkSize points, moved on past any more points with the same x as the one before, so no x
+//is ever split between two chunks - chunkStarts ends with the number of points
+//Read only checks the order of the points inside one chunk, so this also checks that every chunk starts at a larger x than the one
+//before ends - returns false (see GetError) if it doesn't
+bool ChunkedSolver::PlanChunks(PointFileReader& reader, vector<size_t>& chunkStarts) {
+	size_t numPoints = reader.GetNumPoints();
+	vector<int>& xs = workers[0].xs;
+	chunkStarts.assign(1, 0);
+	size_t start = chunkSize;
+	while (start < numPoints) {
+		//read on from the point before the nominal start in small pieces until the x value changes
+		size_t at = start - 1;
+		int previousX = 0;
+		bool found = false;
+		while (!found && at < numPoints) {
+			size_t count = min(static_cast<size_t>(4096), numPoints - at);
+			xs.resize(count);
+			if (!reader.ReadX(at, count, xs.data())) {
+				error = reader.GetError();
+				return false;
+			}
+			if (at == start - 1) previousX = xs[0];
+			for (size_t i = 0; i < count && !found; i++) {
+				if (xs[i] != previousX) {
+					start = at + i;
+					found = true;
+				}
+			}
+			if (found && xs[start - at] < previousX) {
+				error = "invalid, out of order or duplicate point at index " + to_string(start);
+				return false;
+			}
+			if (!found) at += count;
+		}
+		if (!found) break;
+		chunkStarts.push_back(start);
+		start += chunkSize;
+	}
+	if (numPoints > 0) chunkStarts.push_back(numPoints);
+	return true;
+}
+
+//read points first..last-1 into the worker's grid, solve them with the binned method and list the intervals of the result
+//like BatchSolver, the points go straight into a grid private to this solver - Read checks them inside the range and PlanChunks
+//checks the order across chunks, so they come out sorted
+bool ChunkedSolver::SolveRange(chunkWorker& worker, size_t first, size_t last, vector<segment>& segments) {
+	vector<Grid::point>& points = worker.grid.points;
+	if (!worker.reader.Read(first, last - first, points)) return false;
+	const vector<int>& lines = worker.grid.FindOptimalPartitionLines(Grid::SolverType::Binned);
+	PiecewiseModel model;
+	worker.grid.FitModel(lines, model);
+	segments.resize(model.GetNumSegments());
+	size_t start = first;
+	for (int s = 0; s < model.GetNumSegments(); s++) {
+		segments[s] = { (s == 0) ? points[0].x : model.GetLines()[s - 1], start, model.GetErrors()[s] };
+		start += model.GetCounts()[s];
+	}
+	return true;
+}
+
+//run task(worker, i) for i = 0..numTasks-1 over the threads, each claiming the next task from a shared counter as it finishes one
+//stops early and returns false if any task fails, with that task's read error in error
+bool ChunkedSolver::RunOnWorkers(int numTasks, const function<bool(chunkWorker&, int)>& task) {
+	atomic<int> nextTask(0);
+	atomic<bool> failed(false);
+	function<void(int)> runClaimed = [&](int t) {
+		for (int i = nextTask.fetch_add(1); i < numTasks && !failed; i = nextTask.fetch_add(1)) {
+			if (task(workers[t], i)) continue;
+			bool expected = false;
+			if (failed.compare_exchange_strong(expected, true)) error = workers[t].reader.GetError();
+		}
+	};
+	if (pool) pool->Run(static_cast<int>(workers.size()), runClaimed);
+	else runClaimed(0);
+	return !failed;
+}
+
+int ChunkedSolver::GetThreadCount() {
+	return static_cast<int>(workers.size());
+}
+
+double ChunkedSolver::GetPenalty() {
+	return penalty;
+}
+
+size_t ChunkedSolver::GetChunkSize() {
+	return chunkSize;
+}
+
+const string& ChunkedSolver::GetError() const {
+	return error;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include "Grid.h"
+#include "PointFile.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+//what the out of core solver found: the division lines of the whole file, their total cost (error plus the penalty of every interval
+//after the first), and a lower bound on the cost of the best binned partitioning - the optimum lies in [lowerBound, cost]
+//seams is the number of chunk seams that are still division lines only because the chunks were solved apart (see ChunkedSolver)
+struct chunkedPartitioning {
+	vector<int> partitionLines;
+	double cost;
+	double lowerBound;
+	int chunks;
+	int seams;
+};
+
+//solves a point file too big to hold in memory, a chunk of points at a time
+//the file is cut into chunks of about chunkSize points (never splitting the points of one x), and every chunk is solved on its own
+//with the binned method, spread over a pool of threads. putting the chunks' partitionings side by side divides at every seam, so
+//each seam is then solved again inside a window reaching stitchSegments intervals into the chunk on either side - the window's ends
+//are division lines already, so its new partitioning slots straight in. a seam can only be stitched when the chunk after it has
+//more than stitchSegments intervals (so its window ends before the next one starts); otherwise it stays a division line
+//
+//the best partitioning of the file, cut at the seams, costs at least the best partitioning of every chunk on its own - so the sum of
+//the chunks' optimal costs is a lower bound on the optimum, and the result is never more than its cost minus that from optimal
+//only a few chunks are ever read at once (one per thread, or one window of two chunks), so memory depends on chunkSize and the
+//number of threads, not on the size of the file
+class ChunkedSolver {
+
+	//one interval of the partitioning being built: where it starts (as an x value and as a point index in the file), and its error
+	struct segment {
+		int x;
+		size_t first;
+		double error;
+	};
+
+	//one thread's grid and file reader, kept for every chunk or window it solves
+	struct chunkWorker {
+		Grid grid;
+		PointFileReader reader;
+		vector<int> xs;
+	};
+
+	bool PlanChunks(PointFileReader& reader, vector<size_t>& chunkStarts);
+	bool SolveRange(chunkWorker& worker, size_t first, size_t last, vector<segment>& segments);
+	bool RunOnWorkers(int numTasks, const function<bool(chunkWorker&, int)>& task);
+	shared_ptr<ThreadPool> pool;
+	vector<chunkWorker> workers;
+	double penalty;
+	size_t chunkSize;
+	int stitchSegments;
+	string error;
+
+public:
+	ChunkedSolver(int threads = 1, double newPenalty = 10.0, size_t newChunkSize = 1 << 20, int newStitchSegments = 2);
+	bool Solve(const string& path, chunkedPartitioning& result);
+	int GetThreadCount();
+	double GetPenalty();
+	size_t GetChunkSize();
+	const string& GetError() const;
+
+};
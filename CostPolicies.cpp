@@ -0,0 +1,95 @@
+#include "CostPolicies.h"
+
+//this file handles building the sums behind each cost policy
+//like Grid::PrecomputeErrorSums, y values are shifted by their (weighted) mean and summed with compensation first, so the differences
+//taken in Error don't cancel into noise
+
+void squaredErrorCost::Prepare(const Grid::pointColumns& points, int numPoints) {
+	sumY.assign(numPoints + 1, 0.0);
+	sumYSquare.assign(numPoints + 1, 0.0);
+	CompensatedSum total;
+	for (int i = 0; i < numPoints; i++) total.Add(points.Y(i));
+	double shift = (numPoints > 0) ? total.Total() / numPoints : 0.0;
+	CompensatedSum runningY; CompensatedSum runningYSquare;
+	double y = 0.0;
+	for (int i = 1; i <= numPoints; i++) {
+		y = points.Y(i - 1) - shift;
+		runningY.Add(y);
+		runningYSquare.Add(y * y);
+		sumY[i] = runningY.Total();
+		sumYSquare[i] = runningYSquare.Total();
+	}
+}
+
+void weightedSquaredErrorCost::Prepare(const Grid::pointColumns& points, int numPoints) {
+	sumWeight.assign(numPoints + 1, 0.0);
+	sumY.assign(numPoints + 1, 0.0);
+	sumYSquare.assign(numPoints + 1, 0.0);
+	CompensatedSum totalWeight; CompensatedSum totalY;
+	for (int i = 0; i < numPoints; i++) {
+		totalWeight.Add(points.Weight(i));
+		totalY.Add(points.Weight(i) * points.Y(i));
+	}
+	double shift = (numPoints > 0) ? totalY.Total() / totalWeight.Total() : 0.0;
+	CompensatedSum runningWeight; CompensatedSum runningY; CompensatedSum runningYSquare;
+	double y = 0.0; double weight = 0.0;
+	for (int i = 1; i <= numPoints; i++) {
+		y = points.Y(i - 1) - shift;
+		weight = points.Weight(i - 1);
+		runningWeight.Add(weight);
+		runningY.Add(weight * y);
+		runningYSquare.Add(weight * y * y);
+		sumWeight[i] = runningWeight.Total();
+		sumY[i] = runningY.Total();
+		sumYSquare[i] = runningYSquare.Total();
+	}
+}
+
+//rank every y value (ties by position, so ranks are 0..n-1 with no repeats), then build the wavelet matrix one level at a time,
+//most significant rank bit first: each level stably moves the points whose bit is 0 in front of those whose bit is 1
+void absoluteErrorCost::Prepare(const Grid::pointColumns& points, int newNumPoints) {
+	numPoints = newNumPoints;
+	size_t stride = static_cast<size_t>(numPoints) + 1;
+	vector<int> order(numPoints);
+	for (int i = 0; i < numPoints; i++) order[i] = i;
+	stable_sort(order.begin(), order.end(), [&points](int a, int b) { return points.Y(a) < points.Y(b); });
+	//shifting by the overall median (one of the y values, rather than the mean) keeps values that are whole numbers whole,
+	//so their sums stay exact and equally good partitionings tie exactly instead of to within rounding
+	double shift = (numPoints > 0) ? points.Y(order[numPoints / 2]) : 0.0;
+	vector<int> rank(numPoints); vector<double> y(numPoints);
+	for (int i = 0; i < numPoints; i++) {
+		rank[order[i]] = i;
+		y[i] = points.Y(i) - shift;
+	}
+	levels = 0;
+	while (levels < 31 && (numPoints - 1) >> levels != 0) levels++;
+
+	zeros.assign(levels * stride, 0);
+	levelZeros.assign(levels, 0);
+	sums.assign((levels + 1) * stride, 0.0);
+	vector<int> nextRank(numPoints); vector<double> nextY(numPoints);
+	for (int l = 0; l <= levels; l++) {
+		CompensatedSum running;
+		for (int i = 0; i < numPoints; i++) {
+			running.Add(y[i]);
+			sums[l * stride + i + 1] = running.Total();
+		}
+		if (l == levels) break;
+		int bit = levels - 1 - l;
+		int zeroCount = 0;
+		for (int i = 0; i < numPoints; i++) {
+			if (((rank[i] >> bit) & 1) == 0) zeroCount++;
+			zeros[l * stride + i + 1] = zeroCount;
+		}
+		levelZeros[l] = zeroCount;
+		int zeroAt = 0; int oneAt = zeroCount;
+		for (int i = 0; i < numPoints; i++) {
+			int& at = (((rank[i] >> bit) & 1) == 0) ? zeroAt : oneAt;
+			nextRank[at] = rank[i];
+			nextY[at] = y[i];
+			at++;
+		}
+		swap(rank, nextRank);
+		swap(y, nextY);
+	}
+}
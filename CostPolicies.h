@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include "Grid.h"
+
+using namespace std;
+
+//cost policies for Grid::FindOptimalPartitionLinesWithCost(cost, solver) - each one says what the error of approximating an interval of
+//points by a single value is. Prepare builds the policy's sums for the sorted points, and Error(a, b) is the error of positions a..b-1
+//Error is defined here in the header so it can be inlined straight into the solver loops
+
+//sum of (y - mean)^2 - the same error as the built in solvers, from the same compensated, mean shifted prefix sums
+struct squaredErrorCost {
+	vector<double> sumY;
+	vector<double> sumYSquare;
+
+	void Prepare(const Grid::pointColumns& points, int numPoints);
+	double Error(int a, int b) const
+	{
+		int pointsInCell = b - a;
+		double sumYInCell = (sumY[b] - sumY[a]);
+		double average = (pointsInCell == 0) ? 0 : sumYInCell / pointsInCell;
+		double error = (sumYSquare[b] - sumYSquare[a]) - pointsInCell * average * average;
+		return (error < 0) ? 0 : error;
+	}
+};
+
+//sum of w * (y - weighted mean)^2, with each point's weight from AddPoint - prefix sums of w, w*y and w*y^2 give it in constant time
+struct weightedSquaredErrorCost {
+	vector<double> sumWeight;
+	vector<double> sumY;
+	vector<double> sumYSquare;
+
+	void Prepare(const Grid::pointColumns& points, int numPoints);
+	double Error(int a, int b) const
+	{
+		double weightInCell = sumWeight[b] - sumWeight[a];
+		double sumYInCell = (sumY[b] - sumY[a]);
+		double error = (weightInCell <= 0) ? 0 : (sumYSquare[b] - sumYSquare[a]) - sumYInCell * sumYInCell / weightInCell;
+		return (error < 0) ? 0 : error;
+	}
+};
+
+//sum of |y - median| - a robust error, where one wild value can't drag the whole interval's approximation away
+//the median of any range of points is found with a wavelet matrix over the ranks of the y values: one level per bit of the rank,
+//each with counts of the zero bits and prefix sums of y in that level's order, so the median and the sum of the values below it
+//come out of one walk down the levels - O(log n) per interval, using about 12 * log2(n) bytes per point
+struct absoluteErrorCost {
+	int numPoints = 0;
+	int levels = 0;
+	//zeros[l * (numPoints + 1) + i] - points among the first i (in level l's order) whose rank has a 0 at level l's bit
+	vector<int> zeros;
+	vector<int> levelZeros;
+	//sums[l * (numPoints + 1) + i] - sum of the first i y values in level l's order (level 0 is the sorted point order)
+	vector<double> sums;
+
+	void Prepare(const Grid::pointColumns& points, int numPoints);
+	double Error(int a, int b) const
+	{
+		int count = b - a;
+		if (count <= 1) return 0;
+		size_t stride = static_cast<size_t>(numPoints) + 1;
+		double total = sums[b] - sums[a];
+		//the lower median is the value of rank k within the range - walk down the levels towards it, adding up everything smaller
+		int k = (count - 1) / 2;
+		double belowSum = 0; int belowCount = 0;
+		for (int l = 0; l < levels; l++) {
+			const int* levelZero = zeros.data() + l * stride;
+			const double* nextSums = sums.data() + (l + 1) * stride;
+			int zeroA = levelZero[a]; int zeroB = levelZero[b];
+			int zerosInRange = zeroB - zeroA;
+			if (k < zerosInRange) {
+				a = zeroA;
+				b = zeroB;
+			}
+			else {
+				belowSum += nextSums[zeroB] - nextSums[zeroA];
+				belowCount += zerosInRange;
+				k -= zerosInRange;
+				a = levelZeros[l] + (a - zeroA);
+				b = levelZeros[l] + (b - zeroB);
+			}
+		}
+		const double* lastSums = sums.data() + levels * stride;
+		double median = lastSums[a + 1] - lastSums[a];
+		double aboveSum = total - belowSum - median;
+		int aboveCount = count - belowCount - 1;
+		double error = (aboveSum - aboveCount * median) + (belowCount * median - belowSum);
+		return (error < 0) ? 0 : error;
+	}
+};
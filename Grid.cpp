@@ -1,57 +1,142 @@
 #include "Grid.h"
+#include "Kernels.h"
+#include "PointFile.h"
+#include "PiecewiseModel.h"
+#include "PointGenerator.h"
+#include <cstddef>
+#include <limits>
+#include <cmath>
 
 //this file handles all point set functionality - creating a point set, inspecting it, and finding the optimal partitioning of it
 
 Grid::Grid() {
 	penalty = 10.0;
 	largestX = 1;
+	summationMode = SummationMode::Compensated;
+	threadCount = 1;
 }
 
 //return results of search for point in set - helper function for adding points
+//pointIndex mirrors points, so this is a hash lookup instead of a scan over the whole set
 bool Grid::PointsContains(point p) {
-	if (find(points.begin(), points.end(), p) != points.end()) return true;
+	if (pointIndex.find(p) != pointIndex.end()) return true;
 	else return false;
 }
 
 //manually add a point to the set
-//points can share x or y values, but not both (aka no duplicate points)
-bool Grid::AddPoint(int x, double y) {
-	point newPoint = { x, y };
-	if (PointsContains(newPoint)) return false;
+//points can share x or y values, but not both (aka no duplicate points); a weight, if given, has to be positive
+bool Grid::AddPoint(int x, double y, double weight) {
+	point newPoint = { x, y, weight };
+	if (!HasValidWeight(newPoint)) return false;
+	if (!pointIndex.insert(newPoint).second) return false;
 	points.push_back(newPoint);
 	if (newPoint.x > largestX) largestX = newPoint.x;
 	return true;
 }
 
+//a weight has to be positive and finite - the pruned and binned solvers rely on splitting an interval never adding to its error,
+//which a zero, negative or NaN weight would break
+bool Grid::HasValidWeight(const point& p) {
+	return p.weight > 0.0f && !isinf(p.weight);
+}
+
+//add many points at once, with the same no duplicate and weight rules as AddPoint
+//the new points are sorted + deduplicated among themselves in one pass, then checked against the existing set
+//returns the number of points that were actually added (a point with an invalid weight is skipped)
+int Grid::AddPoints(const point* newPoints, size_t count) {
+	vector<point> incoming;
+	incoming.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		if (HasValidWeight(newPoints[i])) incoming.push_back(newPoints[i]);
+	}
+	sort(incoming.begin(), incoming.end(), [](const point& a, const point& b) { return (a.x != b.x) ? a.x < b.x : a.y < b.y; });
+	incoming.erase(unique(incoming.begin(), incoming.end()), incoming.end());
+	points.reserve(points.size() + incoming.size());
+	pointIndex.reserve(pointIndex.size() + incoming.size());
+	int added = 0;
+	for (unsigned int i = 0; i < incoming.size(); i++) {
+		if (!pointIndex.insert(incoming[i]).second) continue;
+		points.push_back(incoming[i]);
+		if (incoming[i].x > largestX) largestX = incoming[i].x;
+		added++;
+	}
+	return added;
+}
+
+int Grid::AddPoints(const vector<point>& newPoints) {
+	return AddPoints(newPoints.data(), newPoints.size());
+}
+
 //randomly add points to the set
 //numberPoints is the number of points to add, maxVal is the largest x value to be generated (the m in the interval [1,m])
+//the seed comes from the clock, so every call makes a different set - the seeded version below makes the same set every time
 void Grid::AddRandomPoints(int numberPoints, int maxVal) {
-	int x = 0; double y = 0;  point newPoint = {};
-	unsigned int seed = static_cast<unsigned int>(chrono::system_clock::now().time_since_epoch().count());
-	default_random_engine generator(seed);
-	uniform_int_distribution<int> distributionInt(1, maxVal);
-	uniform_real_distribution<double> distributionReal(-1.0 * maxVal, static_cast<double>(maxVal));
-	auto randInt = bind(distributionInt, generator);
-	auto randReal = bind(distributionReal, generator);
+	AddRandomPoints(numberPoints, maxVal, static_cast<unsigned long long>(chrono::system_clock::now().time_since_epoch().count()));
+}
+
+//same as above, with the points made by a PointGenerator (see PointGenerator.h) from the given seed, shared out over the grid's
+//thread pool - the result only depends on the seed, never on the thread count
+//a point already in the set is skipped, as in AddPoint - in the rare case one turns up, more points are made to replace it
+void Grid::AddRandomPoints(int numberPoints, int maxVal, unsigned long long seed) {
+	PointGenerator generator(seed, PointGenerator::Shape::Uniform, maxVal);
+	vector<point> generated;
+	size_t next = 0;
+	if (numberPoints > 0) {
+		points.reserve(numberPoints);
+		pointIndex.reserve(numberPoints);
+	}
 	while (static_cast<int>(points.size()) < numberPoints) {
-		x = randInt();
-		y = randReal();
-		newPoint = { x, y };
-		if (!PointsContains(newPoint)) points.push_back(newPoint);
+		size_t count = static_cast<size_t>(numberPoints) - points.size();
+		generated.resize(count);
+		generator.Generate(next, count, generated.data(), pool.get());
+		next += count;
+		for (unsigned int i = 0; i < generated.size(); i++) {
+			if (pointIndex.insert(generated[i]).second) points.push_back(generated[i]);
+		}
 	}
 	largestX = maxVal;
 }
 
 //precompute the errors for the point subsets p_1,p_2,...,p_n for every n
+//each prefix sum extends the previous one, so this is a single pass over the points
+//outside of Standard mode the y values are first shifted by their mean (the error of an interval doesn't change under a shift)
+//and accumulated with compensation or extra precision, so the differences taken in CalculateError don't cancel into noise
 void Grid::PrecomputeErrorSums(int xMax) {
-	sumY = vector<double>(xMax + 1, 0);
-	sumYSquare = vector<double>(xMax + 1, 0);
-	sumY[0] = 0.0; sumYSquare[0] = 0.0;
+	sumY.assign(xMax + 1, 0.0);
+	sumYSquare.assign(xMax + 1, 0.0);
+	double y = 0.0;
 
-	for (int i = 1; i <= xMax; i++) {
-		for (int j = 1; j <= i; j++) {
-			sumY[i] += points[j - 1].y;
-			sumYSquare[i] += (points[j - 1].y * points[j - 1].y);
+	if (summationMode == SummationMode::Standard) {
+		for (int i = 1; i <= xMax; i++) {
+			y = source.Y(i - 1);
+			sumY[i] = sumY[i - 1] + y;
+			sumYSquare[i] = sumYSquare[i - 1] + (y * y);
+		}
+	}
+	else if (summationMode == SummationMode::Compensated) {
+		CompensatedSum total;
+		for (int i = 0; i < xMax; i++) total.Add(source.Y(i));
+		double shift = (xMax > 0) ? total.Total() / xMax : 0.0;
+		CompensatedSum runningY; CompensatedSum runningYSquare;
+		for (int i = 1; i <= xMax; i++) {
+			y = source.Y(i - 1) - shift;
+			runningY.Add(y);
+			runningYSquare.Add(y * y);
+			sumY[i] = runningY.Total();
+			sumYSquare[i] = runningYSquare.Total();
+		}
+	}
+	else {
+		long double total = 0.0L;
+		for (int i = 0; i < xMax; i++) total += source.Y(i);
+		long double shift = (xMax > 0) ? total / xMax : 0.0L;
+		long double runningY = 0.0L; long double runningYSquare = 0.0L; long double shifted = 0.0L;
+		for (int i = 1; i <= xMax; i++) {
+			shifted = source.Y(i - 1) - shift;
+			runningY += shifted;
+			runningYSquare += shifted * shifted;
+			sumY[i] = static_cast<double>(runningY);
+			sumYSquare[i] = static_cast<double>(runningYSquare);
 		}
 	}
 }
@@ -60,146 +145,737 @@ void Grid::PrecomputeErrorSums(int xMax) {
 //precomputed sums all start at x=1, so to get the error of an interval element starting at a > 1 and ending at b >= a,
 //calculate sum from a to b minus the sum from 1 to a
 double Grid::CalculateError(int x1, int x2) {
+	GRID_STATS(stats.errorEvaluations++);
 	int pointsInCell = x2 - x1;
 	double sumYInCell = (sumY[x2] - sumY[x1]);
 	double average = (pointsInCell == 0) ? 0 : sumYInCell / pointsInCell;
 	double error = (sumYSquare[x2] - sumYSquare[x1]) - pointsInCell * average * average;
-	return abs(error);
+	//a true error is never negative - anything below zero is leftover rounding, not a real (absolute) deviation
+	return (error < 0) ? 0 : error;
 }
 
-//find the optimal partitioning of the interval [1,m] using a tabulation / bottom-up approach
-list<int> Grid::FindOptimalPartitionings_Tabulation() {
+//aggregate the sorted points into one bin per distinct x value, with error sums over whole bins
+//the running sums are the same as PrecomputeErrorSums' (same shift and summation mode), but kept only at the end of each bin, so the
+//arrays hold numBins+1 entries rather than one per point
+//returns the number of bins
+int Grid::PrecomputeBinnedErrorSums(int numPoints) {
+	int numBins = PrecomputeBins(numPoints);
+	sumY.assign(numBins + 1, 0.0);
+	sumYSquare.assign(numBins + 1, 0.0);
+	double y = 0.0;
+	int i = 0;
+
+	if (summationMode == SummationMode::Standard) {
+		double runningY = 0.0; double runningYSquare = 0.0;
+		for (int b = 1; b <= numBins; b++) {
+			for (; i < binEnd[b]; i++) {
+				y = source.Y(i);
+				runningY += y;
+				runningYSquare += y * y;
+			}
+			sumY[b] = runningY;
+			sumYSquare[b] = runningYSquare;
+		}
+	}
+	else if (summationMode == SummationMode::Compensated) {
+		CompensatedSum total;
+		for (int p = 0; p < numPoints; p++) total.Add(source.Y(p));
+		double shift = (numPoints > 0) ? total.Total() / numPoints : 0.0;
+		CompensatedSum runningY; CompensatedSum runningYSquare;
+		for (int b = 1; b <= numBins; b++) {
+			for (; i < binEnd[b]; i++) {
+				y = source.Y(i) - shift;
+				runningY.Add(y);
+				runningYSquare.Add(y * y);
+			}
+			sumY[b] = runningY.Total();
+			sumYSquare[b] = runningYSquare.Total();
+		}
+	}
+	else {
+		long double total = 0.0L;
+		for (int p = 0; p < numPoints; p++) total += source.Y(p);
+		long double shift = (numPoints > 0) ? total / numPoints : 0.0L;
+		long double runningY = 0.0L; long double runningYSquare = 0.0L; long double shifted = 0.0L;
+		for (int b = 1; b <= numBins; b++) {
+			for (; i < binEnd[b]; i++) {
+				shifted = source.Y(i) - shift;
+				runningY += shifted;
+				runningYSquare += shifted * shifted;
+			}
+			sumY[b] = static_cast<double>(runningY);
+			sumYSquare[b] = static_cast<double>(runningYSquare);
+		}
+	}
+	return numBins;
+}
+
+//find the distinct x values of the sorted points (binX) and the number of points up to the end of each one's bin (binEnd)
+//returns the number of bins
+int Grid::PrecomputeBins(int numPoints) {
+	binX.clear();
+	binEnd.assign(1, 0);
+	for (int i = 1; i <= numPoints; i++) {
+		if (i == numPoints || source.X(i) != source.X(i - 1)) {
+			binX.push_back(source.X(i - 1));
+			binEnd.push_back(i);
+		}
+	}
+	return static_cast<int>(binX.size());
+}
+
+//same as CalculateError, but over whole bins b1+1..b2, so the number of points comes from the bin ends
+double Grid::CalculateBinnedError(int b1, int b2) {
+	GRID_STATS(stats.errorEvaluations++);
+	int pointsInCell = binEnd[b2] - binEnd[b1];
+	double sumYInCell = (sumY[b2] - sumY[b1]);
+	double average = (pointsInCell == 0) ? 0 : sumYInCell / pointsInCell;
+	double error = (sumYSquare[b2] - sumYSquare[b1]) - pointsInCell * average * average;
+	return (error < 0) ? 0 : error;
+}
+
+//find the optimal partitioning of the interval [1,m] with the chosen method and return its division lines
+//every method records only the start of the optimal "last segment" for each prefix of points (lastSegmentStart),
+//and the division lines are rebuilt once at the end instead of carrying a copy of them for every prefix
+const vector<int>& Grid::FindOptimalPartitionLines(SolverType solver) {
 	//set up - we want to sort points so that the first j points in the set are the first j points relative to x values
 	//then precompute the error sums so that CalculateError can be used to find the error of any interval [a,b] in constant time
+	GRID_STATS(LapPhase());
+	int numPoints = PreparePoints();
+	GRID_STATS(stats.sortTime += LapPhase());
+	SolveSource(numPoints, solver);
+	return partitionLines;
+}
+
+//same as above, but for the points of a mapped point file instead of the grid's own - the file is already sorted and checked when
+//it's opened, so the solvers read its columns in place, with nothing copied into the grid
+const vector<int>& Grid::FindOptimalPartitionLines(const PointFile& file, SolverType solver) {
+	source.x = reinterpret_cast<const char*>(file.GetX());
+	source.y = reinterpret_cast<const char*>(file.GetY());
+	source.xStride = sizeof(int);
+	source.yStride = sizeof(double);
+	source.weight = nullptr;
+	GRID_STATS(LapPhase());
+	SolveSource(file.GetNumPoints(), solver);
+	return partitionLines;
+}
+
+//sort the grid's points by x and make them the points the solvers read - returns how many there are
+int Grid::PreparePoints() {
 	int numPoints = static_cast<int>(points.size());
-	SortPoints(points, 0, numPoints - 1);
+	SortPoints();
+	source.x = reinterpret_cast<const char*>(points.data()) + offsetof(point, x);
+	source.y = reinterpret_cast<const char*>(points.data()) + offsetof(point, y);
+	source.weight = reinterpret_cast<const char*>(points.data()) + offsetof(point, weight);
+	source.xStride = sizeof(point);
+	source.yStride = sizeof(point);
+	source.weightStride = sizeof(point);
+	return numPoints;
+}
+
+//precompute the error sums for the first numPoints sorted points in source, run the chosen solver and build the division lines
+void Grid::SolveSource(int numPoints, SolverType solver) {
+	partitionLines.clear();
+	if (numPoints == 0) return;
+	GRID_STATS(array<size_t, 17> capacities = BufferCapacities(); stats.solves++);
+	if (solver == SolverType::Binned) {
+		//points sharing an x can never be split up anyway, so run the DP over the distinct x values instead
+		int numBins = PrecomputeBinnedErrorSums(numPoints);
+		lastSegmentStart.assign(numBins + 1, 0);
+		GRID_STATS(stats.precomputeTime += LapPhase());
+		SolvePruned(numBins, [this](int b1, int b2) { return CalculateBinnedError(b1, b2); });
+		GRID_STATS(stats.solveTime += LapPhase());
+		BuildPartitionLines(numBins, true);
+		GRID_STATS(stats.partitionTime += LapPhase(); CountBufferGrowth(capacities));
+		return;
+	}
 	PrecomputeErrorSums(numPoints);
+	lastSegmentStart.assign(numPoints + 1, 0);
+	GRID_STATS(stats.precomputeTime += LapPhase());
+	if (solver == SolverType::Tabulation) SolveTabulation(numPoints, sumY.data(), sumYSquare.data());
+	else if (solver == SolverType::ParallelTabulation) SolveParallelTabulation(numPoints);
+	else if (solver == SolverType::Memoization) SolveMemoization(numPoints, [this](int x1, int x2) { return CalculateError(x1, x2); });
+	else SolvePruned(numPoints, [this](int x1, int x2) { return CalculateError(x1, x2); });
+	GRID_STATS(stats.solveTime += LapPhase());
+	BuildPartitionLines(numPoints);
+	GRID_STATS(stats.partitionTime += LapPhase(); CountBufferGrowth(capacities));
+}
+
+//fit the piecewise constant model of a partitioning to the grid's points: the mean, squared error and point count of every segment
+//lines are division lines as the solvers return them (or any others, in increasing order) - returns false if they aren't in order
+bool Grid::FitModel(const vector<int>& lines, PiecewiseModel& model) {
+	int numPoints = PreparePoints();
+	return FitSource(numPoints, lines, model);
+}
+
+//same as above, for the points of a mapped point file
+bool Grid::FitModel(const PointFile& file, const vector<int>& lines, PiecewiseModel& model) {
+	source.x = reinterpret_cast<const char*>(file.GetX());
+	source.y = reinterpret_cast<const char*>(file.GetY());
+	source.xStride = sizeof(int);
+	source.yStride = sizeof(double);
+	source.weight = nullptr;
+	return FitSource(file.GetNumPoints(), lines, model);
+}
+
+//one pass over the sorted points per segment for its mean, and another for its error around that mean (rather than taking the error
+//from prefix sums, which loses digits when the segment's spread is small next to its mean)
+bool Grid::FitSource(int numPoints, const vector<int>& lines, PiecewiseModel& model) {
+	size_t segments = lines.size() + 1;
+	vector<double> means(segments, 0.0); vector<double> errors(segments, 0.0); vector<int> counts(segments, 0);
+	int begin = 0; int end = 0; double difference = 0.0;
+	for (size_t s = 0; s < segments; s++) {
+		while (end < numPoints && (s == lines.size() || source.X(end) < lines[s])) end++;
+		CompensatedSum sum; CompensatedSum squares;
+		for (int i = begin; i < end; i++) sum.Add(source.Y(i));
+		counts[s] = end - begin;
+		means[s] = (counts[s] > 0) ? sum.Total() / counts[s] : 0.0;
+		for (int i = begin; i < end; i++) {
+			difference = source.Y(i) - means[s];
+			squares.Add(difference * difference);
+		}
+		errors[s] = squares.Total();
+		begin = end;
+	}
+	return model.Assign(lines, means, errors, counts);
+}
+
+//find the optimal partitioning of the interval [1,m] using the pruned bottom-up approach over distinct x values
+//cuts can only fall between different x values, so this is the method to use when many points share an x
+list<int> Grid::FindOptimalPartitionings_Binned() {
+	const vector<int>& lines = FindOptimalPartitionLines(SolverType::Binned);
+	return list<int>(lines.begin(), lines.end());
+}
+
+//find the optimal partitioning of the interval [1,m] using a tabulation / bottom-up approach
+list<int> Grid::FindOptimalPartitionings_Tabulation() {
+	const vector<int>& lines = FindOptimalPartitionLines(SolverType::Tabulation);
+	return list<int>(lines.begin(), lines.end());
+}
+
+//find the optimal partitioning of the interval [1,m] using a memoization / top-down approach
+list<int> Grid::FindOptimalPartitionings_Memoization() {
+	const vector<int>& lines = FindOptimalPartitionLines(SolverType::Memoization);
+	return list<int>(lines.begin(), lines.end());
+}
+
+//find the optimal partitioning of the interval [1,m] using the same Bellman equation as tabulation, but pruning (PELT-style)
+//any start of the "last segment" that can never be optimal again, so each OPT(i) only scans the starts still in the running
+list<int> Grid::FindOptimalPartitionings_Pruned() {
+	const vector<int>& lines = FindOptimalPartitionLines(SolverType::Pruned);
+	return list<int>(lines.begin(), lines.end());
+}
+
+//bottom-up fill of OPT for the first i points, i = 1..n, with the squared error taken from the prefix sums given
+//(the grid's own, or those of a squaredErrorCost policy)
+void Grid::SolveTabulation(int numPoints, const double* sums, const double* sumSquares) {
 	//base case, error for 0 points = 0
-	vector<double> OPT(numPoints + 1);
-	OPT[0] = 0.0;
-	vector<list<int>> partitionings(numPoints + 1);
-	int tempPartitioning = 1;
-	double tempMinimum = 0; double minimumVal = 0; int lastDivision = 0;
+	vector<double>& OPT = arena.OPT;
+	OPT.assign(numPoints + 1, 0.0);
+	int tempPartitioning = 0;
+	double minimumVal = 0;
 	//find the minimum cost for the first i points by finding an optimum "last segment" 
 	//and adding its error to the cost of the points up to the start of the "last segment" (+penalty for adding another interval)
+	//the scan over every start j-1 of the last segment is done by FindBestSegmentStart, which evaluates many starts at once
+	//with whatever vector instructions the cpu has, and keeps the same <= tie-breaking as a plain loop over j
+	double average = 0;
 	for (int i = 1; i <= numPoints; i++) {
+		//error of the whole of the first i points as one interval - CalculateError written out for the sums given
+		average = sums[i] / i;
+		minimumVal = sumSquares[i] - i * average * average;
+		minimumVal = (minimumVal < 0) ? 0 : minimumVal;
+		tempPartitioning = 0;
+		FindBestSegmentStart(sums, sumSquares, OPT.data(), penalty, i, 0, i, minimumVal, tempPartitioning);
+		GRID_STATS(stats.errorEvaluations += i + 1);
+		OPT[i] = minimumVal;
+		lastSegmentStart[i] = tempPartitioning;
+	}
+}
+
+//bottom-up fill of OPT with the scan over the starts of the last segment split into one contiguous chunk per thread
+//each chunk finds its own best start, then the chunks are folded in order with the same <= rule, which lands on exactly the start
+//the serial scan would have picked - so the partitioning is identical to SolveTabulation for any number of threads
+void Grid::SolveParallelTabulation(int numPoints) {
+	//below this many starts per thread, handing the scan to the pool costs more than it saves
+	const int minimumStartsPerThread = 2048;
+	vector<double>& OPT = arena.OPT;
+	OPT.assign(numPoints + 1, 0.0);
+	int threads = (pool) ? pool->GetNumThreads() : 1;
+	arena.chunkMinimum.assign(threads, 0.0);
+	arena.chunkStart.assign(threads, 0);
+	int tempPartitioning = 0; int chunkSize = 0; int chunks = 0; int i = 0;
+	double minimumVal = 0;
+	function<void(int)> scanChunk = [&](int chunk) {
+		int first = chunk * chunkSize;
+		int last = min(i, first + chunkSize);
+		arena.chunkMinimum[chunk] = numeric_limits<double>::infinity();
+		arena.chunkStart[chunk] = -1;
+		FindBestSegmentStart(sumY.data(), sumYSquare.data(), OPT.data(), penalty, i, first, last, arena.chunkMinimum[chunk], arena.chunkStart[chunk]);
+	};
+	for (i = 1; i <= numPoints; i++) {
 		minimumVal = CalculateError(0, i);
-		for (int j = 1; j <= i; j++) {
-			tempMinimum = CalculateError(j-1, i) + OPT[j-1] + penalty;
-			if (tempMinimum <= minimumVal) { 
-				minimumVal = tempMinimum;
-				tempPartitioning = j;
+		tempPartitioning = 0;
+		chunks = min(threads, i / minimumStartsPerThread);
+		if (chunks <= 1) FindBestSegmentStart(sumY.data(), sumYSquare.data(), OPT.data(), penalty, i, 0, i, minimumVal, tempPartitioning);
+		else {
+			chunkSize = (i + chunks - 1) / chunks;
+			pool->Run(chunks, scanChunk);
+			for (int chunk = 0; chunk < chunks; chunk++) {
+				if (arena.chunkStart[chunk] >= 0 && arena.chunkMinimum[chunk] <= minimumVal) {
+					minimumVal = arena.chunkMinimum[chunk];
+					tempPartitioning = arena.chunkStart[chunk];
+				}
 			}
 		}
-		//update partitionings alongside OPT so there's no need to post-process / backtrack for a solution after OPT(n) is found
+		GRID_STATS(stats.errorEvaluations += i);
 		OPT[i] = minimumVal;
-		if(tempPartitioning > 0) partitionings[i] = partitionings[tempPartitioning - 1];
-		if (tempPartitioning - 1 > 0 && points[tempPartitioning - 1].x != lastDivision && points[tempPartitioning - 1].x != points[0].x) {
-			partitionings[i].push_back(points[tempPartitioning - 1].x);
-			lastDivision = points[tempPartitioning - 1].x;
-		}
+		lastSegmentStart[i] = tempPartitioning;
 	}
-	return partitionings[numPoints];
 }
 
-//find the optimal partitioning of the interval [1,m] using a memoization / top-down approach
-list<int> Grid::FindOptimalPartitionings_Memoization() {
-	//setup for the actual recursive/top down call
-	//same logic as bottom-up for sorting + precomputing error sums
-	int numPoints = static_cast<int>(points.size());
-	SortPoints(points, 0, numPoints - 1);
-	PrecomputeErrorSums(numPoints);
-	unordered_map<int, double> OPT;
-	unordered_map<int, list<int>> partitionings;
-	//the actual recursive/top down call
-	MemoizationHelper(OPT, partitionings, numPoints);
-	list<int> toReturn = partitionings[numPoints];
-	return toReturn;
+//walk back through the start of each optimal last segment to recover the division lines for the first numPoints points (or bins)
+//a division is placed at the x value of the first point of each segment, skipping repeats of an x value already used
+void Grid::BuildPartitionLines(int numPoints, bool binned) {
+	partitionLines.clear();
+	for (int i = numPoints; lastSegmentStart[i] > 0; i = lastSegmentStart[i]) {
+		int divisionX = (binned) ? binX[lastSegmentStart[i]] : source.X(lastSegmentStart[i]);
+		if (divisionX != source.X(0) && (partitionLines.empty() || partitionLines.back() != divisionX))
+			partitionLines.push_back(divisionX);
+	}
+	reverse(partitionLines.begin(), partitionLines.end());
+	GRID_STATS(stats.segments = static_cast<int>(partitionLines.size()) + 1);
 }
 
-//the actual recursive function that finds OPT(n)
-double Grid::MemoizationHelper(unordered_map<int, double> &OPT, unordered_map<int, list<int>> &partitionings, int i) {
-	//same Bellman equation as in bottom-up method, but only calculate a value if it's deemed necessary instead of starting at the bottom + doing everything
-	if (OPT.find(i) == OPT.end()) {
-		if (i < 1) {
-			OPT[i] = 0.0;
-			partitionings[i] = { {}, {}, 0 };
+//sort the points by x, keeping points that share an x in the order they were added (the solvers that don't bin can cut between them)
+//points that are already in order - every solve after the first, unless more points were added - are only scanned, not moved
+//otherwise it's a stable LSD radix sort on x - min x, in one pass when the x values span at most 2^16 (a plain counting sort) and
+//two otherwise - through one scratch buffer kept in the arena, so re-sorting doesn't allocate either
+void Grid::SortPoints() {
+	//a pass only goes to the pool past this many points - below it counting is quicker than waking the workers
+	const int minimumPointsForThreads = 1 << 16;
+	int numPoints = static_cast<int>(points.size());
+	if (numPoints < 2) return;
+	bool sorted = true; int minimumX = points[0].x; int maximumX = points[0].x;
+	for (int i = 1; i < numPoints; i++) {
+		if (points[i].x < points[i - 1].x) sorted = false;
+		minimumX = min(minimumX, points[i].x);
+		maximumX = max(maximumX, points[i].x);
+	}
+	if (sorted) return;
+	//a handful of points is quicker to insertion sort than to clear even one table of counts for
+	if (numPoints <= 32) {
+		for (int i = 1; i < numPoints; i++) {
+			point moving = points[i]; int j = i;
+			for (; j > 0 && points[j - 1].x > moving.x; j--) points[j] = points[j - 1];
+			points[j] = moving;
 		}
-		else {
-			double minimumVal = CalculateError(0, i);
-			double tempMinimum = 0.0; int tempPartitioning = 0;
-			for (int j = 1; j <= i; j++) {
-				tempMinimum = CalculateError(j - 1, i) + MemoizationHelper(OPT, partitionings, j - 1) + penalty;
-				if (tempMinimum <= minimumVal) {
-					minimumVal = tempMinimum;
-					tempPartitioning = j;
-				}
-			}
-			OPT[i] = minimumVal;
-			//no need to make a sepaarte function call for partitionings since it's set alongside OPT, and OPT(tempPartitioning -1) was called above
-			list<int> lastSet;
-			if (tempPartitioning - 1 > 0) lastSet = partitionings[tempPartitioning - 1];
-			if (tempPartitioning > 0) partitionings[i] = lastSet;
-			if (tempPartitioning - 1 > 0 && points[tempPartitioning - 1].x != points[0].x && find(lastSet.begin(), lastSet.end(), points[tempPartitioning - 1].x) == lastSet.end())
-				partitionings[i].push_back(points[tempPartitioning - 1].x);
+		return;
+	}
+	GRID_STATS(array<size_t, 17> capacities = BufferCapacities());
+	unsigned int range = static_cast<unsigned int>(maximumX) - static_cast<unsigned int>(minimumX);
+	int bits = 0;
+	while (bits < 32 && (range >> bits) != 0) bits++;
+	int passes = (bits + 15) / 16;
+	int digitBits = (bits + passes - 1) / passes;
+	int buckets = 1 << digitBits;
+	int threads = (pool && numPoints >= minimumPointsForThreads) ? pool->GetNumThreads() : 1;
+	int blockSize = (numPoints + threads - 1) / threads;
+	vector<point>& scratch = arena.sortScratch;
+	vector<int>& counts = arena.sortCounts;
+	scratch.resize(numPoints);
+	int shift = 0;
+	//counts are laid out digit by digit, and within a digit block by block - so the running total over them hands each block of
+	//points its own run inside each digit's range, in block order, and the scatter stays stable with every block working alone
+	function<void(int)> countBlock = [&](int block) {
+		int last = min(numPoints, (block + 1) * blockSize);
+		for (int i = block * blockSize; i < last; i++) {
+			counts[(((static_cast<unsigned int>(points[i].x) - minimumX) >> shift) & (buckets - 1)) * threads + block]++;
+		}
+	};
+	function<void(int)> scatterBlock = [&](int block) {
+		int last = min(numPoints, (block + 1) * blockSize);
+		for (int i = block * blockSize; i < last; i++) {
+			scratch[counts[(((static_cast<unsigned int>(points[i].x) - minimumX) >> shift) & (buckets - 1)) * threads + block]++] = points[i];
 		}
+	};
+	for (int pass = 0; pass < passes; pass++) {
+		shift = pass * digitBits;
+		counts.assign(static_cast<size_t>(buckets) * threads, 0);
+		if (threads > 1) pool->Run(threads, countBlock);
+		else countBlock(0);
+		int total = 0; int count = 0;
+		for (size_t c = 0; c < counts.size(); c++) {
+			count = counts[c];
+			counts[c] = total;
+			total += count;
+		}
+		if (threads > 1) pool->Run(threads, scatterBlock);
+		else scatterBlock(0);
+		swap(points, scratch);
 	}
-	return OPT[i];
+	GRID_STATS(CountBufferGrowth(capacities));
 }
 
-//merge sort - used to sort the points based on their x coordinates
-void Grid::SortPoints(vector<point>& points, int left, int right) {
-	if (left < right) {
-		int middle = static_cast<int>((left + right) / 2);
-		SortPoints(points, left, middle);
-		SortPoints(points, middle + 1, right);
-		Merge(points, left, middle, right);
+//find every distinct optimal partitioning for penalties in [minimumPenalty, maximumPenalty], along with the penalties where it changes
+//for a fixed partitioning the total cost is error + penalty * (intervals - 1), a line in the penalty, and the optimum is the lower
+//envelope of those lines - so the binned DP only has to be run where two known lines cross (CROPS), not for every penalty of interest
+//the points are sorted and the bin sums built once for the whole path; results are ordered from the lowest penalty to the highest
+vector<Grid::penaltyPathEntry> Grid::FindPenaltyPath(double minimumPenalty, double maximumPenalty) {
+	vector<penaltyPathEntry> path;
+	if (points.empty()) return path;
+	if (minimumPenalty > maximumPenalty) swap(minimumPenalty, maximumPenalty);
+	double originalPenalty = penalty;
+	int numPoints = PreparePoints();
+	int numBins = PrecomputeBinnedErrorSums(numPoints);
+
+	//solutions found so far, one per number of intervals - a higher penalty never gives more intervals
+	vector<penaltyPathEntry> found;
+	found.push_back(SolveBinnedForPenalty(numBins, minimumPenalty));
+	found.push_back(SolveBinnedForPenalty(numBins, maximumPenalty));
+	//pairs of neighbouring solutions (by number of intervals) that may still have another solution in between
+	vector<pair<int, int>> pending;
+	if (found[0].intervals > found[1].intervals + 1) pending.push_back({ 0, 1 });
+	while (!pending.empty()) {
+		int many = pending.back().first; int few = pending.back().second;
+		pending.pop_back();
+		//the penalty where the two lines cross - if the optimum there is one of the two, nothing lies between them
+		double crossing = (found[few].error - found[many].error) / (found[many].intervals - found[few].intervals);
+		penaltyPathEntry middle = SolveBinnedForPenalty(numBins, crossing);
+		if (middle.intervals >= found[many].intervals || middle.intervals <= found[few].intervals) continue;
+		found.push_back(middle);
+		int added = static_cast<int>(found.size()) - 1;
+		if (found[many].intervals > middle.intervals + 1) pending.push_back({ many, added });
+		if (middle.intervals > found[few].intervals + 1) pending.push_back({ added, few });
 	}
+
+	//order by decreasing number of intervals (increasing penalty), drop repeats and fill in where each one stops being optimal
+	sort(found.begin(), found.end(), [](const penaltyPathEntry& a, const penaltyPathEntry& b) { return a.intervals > b.intervals; });
+	for (unsigned int i = 0; i < found.size(); i++) {
+		if (!path.empty() && path.back().intervals == found[i].intervals) continue;
+		path.push_back(found[i]);
+	}
+	for (unsigned int i = 0; i < path.size(); i++) {
+		path[i].minimumPenalty = (i == 0) ? minimumPenalty : path[i - 1].maximumPenalty;
+		if (i + 1 == path.size()) path[i].maximumPenalty = maximumPenalty;
+		else path[i].maximumPenalty = (path[i + 1].error - path[i].error) / (path[i].intervals - path[i + 1].intervals);
+	}
+	penalty = originalPenalty;
+	return path;
 }
 
-//merge for merge sort
-void Grid::Merge(vector<point>& points, int left, int middle, int right) {
-	int l = 0; int r = 0; int merge = left;
-	int leftSubMax = middle - left + 1;
-	int rightSubMax = right - middle;
-	vector<point> leftSubArray(leftSubMax); vector<point> rightSubArray(rightSubMax);
-	for (int i = 0; i < leftSubMax; i++) {
-		leftSubArray[i] = points[left + i];
+//run the binned DP for one penalty on bin sums that are already built, and summarise the optimal partitioning it finds
+Grid::penaltyPathEntry Grid::SolveBinnedForPenalty(int numBins, double newPenalty) {
+	penalty = newPenalty;
+	lastSegmentStart.assign(numBins + 1, 0);
+	SolvePruned(numBins, [this](int b1, int b2) { return CalculateBinnedError(b1, b2); });
+	BuildPartitionLines(numBins, true);
+	penaltyPathEntry entry = { newPenalty, newPenalty, 0, 0.0, partitionLines };
+	for (int b = numBins; b > 0; b = lastSegmentStart[b]) {
+		entry.error += CalculateBinnedError(lastSegmentStart[b], b);
+		entry.intervals++;
 	}
-	for (int i = 0; i < rightSubMax; i++) {
-		rightSubArray[i] = points[middle + 1 + i];
+	if (entry.intervals == 0) entry.intervals = 1;
+	return entry;
+}
+
+//find a partitioning close to the binned optimum in a fraction of the time, along with how far from optimal it can be
+//the bins are first grouped into blocks of blockSize distinct x values and the DP only places divisions between blocks; each
+//level after that halves the block size, but only within refineWindow (old) blocks either side of a division the last level
+//found - everywhere else the cut positions stay as they were - until divisions near the coarse ones can fall between any two bins
+//every level can still pick the divisions of the level before, so the cost never goes up from one level to the next
+//a bigger blockSize (rounded down to a power of two, and shrunk so the first level has at least 64 blocks) or a smaller window is
+//faster but can miss more; blockSize 1 is the exact binned method
+Grid::approximatePartitioning Grid::FindApproximatePartitioning(int blockSize, int refineWindow) {
+	approximatePartitioning result = { vector<int>(), 0.0, 0.0, 0 };
+	partitionLines.clear();
+	if (points.empty()) return result;
+	int numPoints = PreparePoints();
+	int numBins = PrecomputeBinnedErrorSums(numPoints);
+	GRID_STATS(stats.solves++);
+	int step = 1;
+	while (step * 2 <= blockSize && numBins / (step * 2) >= 64) step *= 2;
+	refineWindow = max(refineWindow, 1);
+
+	vector<int> positions; vector<int> cuts; vector<int> added;
+	for (int b = 0; b < numBins; b += step) positions.push_back(b);
+	positions.push_back(numBins);
+	result.cost = SolveBinnedPositions(positions, cuts);
+	while (step > 1) {
+		int reach = refineWindow * step;
+		step /= 2;
+		added.clear();
+		for (unsigned int c = 0; c < cuts.size(); c++) {
+			int last = min(numBins, cuts[c] + reach);
+			for (int b = (max(0, cuts[c] - reach) + step - 1) / step * step; b <= last; b += step) added.push_back(b);
+		}
+		positions.insert(positions.end(), added.begin(), added.end());
+		sort(positions.begin(), positions.end());
+		positions.erase(unique(positions.begin(), positions.end()), positions.end());
+		result.cost = SolveBinnedPositions(positions, cuts);
 	}
-	while (l < leftSubMax && r < rightSubMax) {
-		if (leftSubArray[l].x <= rightSubArray[r].x) {
-			points[merge] = leftSubArray[l];
-			l++;
+
+	for (unsigned int c = 0; c < cuts.size(); c++) partitionLines.push_back(binX[cuts[c]]);
+	GRID_STATS(stats.segments = static_cast<int>(partitionLines.size()) + 1);
+	result.partitionLines = partitionLines;
+	result.lowerBound = min(CalculateLowerBound(positions), result.cost);
+	result.positions = static_cast<int>(positions.size());
+	return result;
+}
+
+//run the binned DP with divisions allowed only at the given bin positions (which start at 0 and end at the number of bins)
+//cuts is set to the bins the optimal partitioning divides at, in order - returns its cost
+double Grid::SolveBinnedPositions(const vector<int>& positions, vector<int>& cuts) {
+	int numPositions = static_cast<int>(positions.size()) - 1;
+	lastSegmentStart.assign(numPositions + 1, 0);
+	SolvePruned(numPositions, [this, &positions](int p1, int p2) { return CalculateBinnedError(positions[p1], positions[p2]); });
+	cuts.clear();
+	for (int p = numPositions; lastSegmentStart[p] > 0; p = lastSegmentStart[p]) cuts.push_back(positions[lastSegmentStart[p]]);
+	reverse(cuts.begin(), cuts.end());
+	return arena.OPT[numPositions];
+}
+
+//a lower bound on the cost of every binned partitioning, from the blocks of bins between neighbouring positions
+//the error of an interval is at least the sum of the errors of its parts, so a partitioning costs at least the error of every run
+//of whole blocks with no division inside or between them, plus a penalty for each division between blocks, plus for every block
+//with a division inside it the least that block could cost on its own with one (see BoundBlock). labelling every block as part of
+//a run or as divided and taking the cheapest labelling is a DP much like the one over the positions, and can't beat the optimum
+double Grid::CalculateLowerBound(const vector<int>& positions) {
+	int numPositions = static_cast<int>(positions.size()) - 1;
+	double infinity = numeric_limits<double>::infinity();
+	//runEnd[p] - least cost of the blocks up to position p with a run ending at p; divided[p] - the same, with block p divided inside
+	//startCost[p] - least cost of everything before a run that starts at p
+	vector<double> runEnd(numPositions + 1, 0.0);
+	vector<double> divided(numPositions + 1, infinity);
+	vector<double> startCost(numPositions + 1, 0.0);
+	vector<int>& candidates = arena.candidates; vector<double>& candidateCosts = arena.candidateCosts;
+	candidates.assign(1, 0);
+	double minimumVal = 0; double whole = 0; double blockDivided = 0;
+	for (int p = 1; p <= numPositions; p++) {
+		minimumVal = infinity;
+		candidateCosts.resize(candidates.size());
+		for (size_t c = 0; c < candidates.size(); c++) {
+			candidateCosts[c] = startCost[candidates[c]] + CalculateBinnedError(positions[candidates[c]], positions[p]);
+			if (candidateCosts[c] < minimumVal) minimumVal = candidateCosts[c];
 		}
-		else {
-			points[merge] = rightSubArray[r];
-			r++;
+		runEnd[p] = minimumVal;
+		BoundBlock(positions[p - 1], positions[p], whole, blockDivided);
+		divided[p] = min(runEnd[p - 1], divided[p - 1]) + blockDivided;
+		startCost[p] = min(runEnd[p] + penalty, divided[p]);
+		//same pruning as SolvePruned: a run start that already costs more than starting at p never wins again
+		size_t kept = 0;
+		for (size_t c = 0; c < candidates.size(); c++) {
+			if (candidateCosts[c] <= startCost[p]) candidates[kept++] = candidates[c];
+		}
+		candidates.resize(kept);
+		candidates.push_back(p);
+	}
+	return min(runEnd[numPositions], divided[numPositions]);
+}
+
+//bounds for the bins firstBin+1..lastBin taken on their own: whole is their error as one interval, divided a lower bound on their
+//error plus penalties when at least one division falls inside them (infinity for a single bin, which can't be divided)
+//splitting the block in half, each half is either whole or divided itself, with a division between the halves costing a penalty
+//if neither half has one - so the bound comes from the halves' bounds. a block of two bins just uses the penalty of the division,
+//leaving out the two bins' own errors (nothing, when each x has one point) but halving the number of errors the bound needs
+void Grid::BoundBlock(int firstBin, int lastBin, double& whole, double& divided) {
+	whole = CalculateBinnedError(firstBin, lastBin);
+	if (lastBin - firstBin <= 2) {
+		divided = (lastBin - firstBin > 1) ? penalty : numeric_limits<double>::infinity();
+		return;
+	}
+	int middle = firstBin + (lastBin - firstBin) / 2;
+	double leftWhole = 0; double leftDivided = 0; double rightWhole = 0; double rightDivided = 0;
+	BoundBlock(firstBin, middle, leftWhole, leftDivided);
+	BoundBlock(middle, lastBin, rightWhole, rightDivided);
+	divided = min(leftWhole, leftDivided) + penalty + min(rightWhole, rightDivided);
+	divided = min(divided, min(leftDivided + rightWhole, leftWhole + rightDivided));
+	divided = min(divided, leftDivided + rightDivided);
+}
+
+//find the partitioning of the interval [1,m] into exactly k intervals with the least total error (no penalty involved)
+//cuts only fall between distinct x values, so k is capped at the number of distinct x values
+list<int> Grid::FindOptimalPartitionings_K(int intervals) {
+	const vector<int>& lines = FindPartitionLinesForIntervals(intervals);
+	return list<int>(lines.begin(), lines.end());
+}
+
+//the exactly k version of the binned DP: OPT_L(t) = min over s of OPT_L-1(s) + error(s, t), one layer of OPT per interval
+//only two layers are ever held at once, so instead of backpointers for every layer the cuts are recovered by splitting the
+//problem in the middle (see SplitIntoIntervals), which keeps the memory at O(number of bins) for any k
+const vector<int>& Grid::FindPartitionLinesForIntervals(int intervals) {
+	partitionLines.clear();
+	if (points.empty()) return partitionLines;
+	int numPoints = PreparePoints();
+	int numBins = PrecomputeBinnedErrorSums(numPoints);
+	intervals = max(1, min(intervals, numBins));
+	vector<int> cuts;
+	cuts.reserve(intervals - 1);
+	SplitIntoIntervals(0, numBins, intervals, cuts);
+	sort(cuts.begin(), cuts.end());
+	for (unsigned int i = 0; i < cuts.size(); i++) partitionLines.push_back(binX[cuts[i]]);
+	return partitionLines;
+}
+
+//find the cuts of the best partitioning of bins firstBin+1..lastBin into exactly the given number of intervals (Hirschberg style)
+//the best cost of the first t bins in half of the intervals plus the best cost of the remaining bins in the other half is smallest
+//at the cut where the optimal partitioning crosses from one half to the other - so each half can then be solved on its own
+void Grid::SplitIntoIntervals(int firstBin, int lastBin, int intervals, vector<int>& cuts) {
+	if (intervals <= 1) return;
+	int numPositions = lastBin - firstBin;
+	int leftIntervals = intervals / 2;
+	int rightIntervals = intervals - leftIntervals;
+	vector<double> leftBest; vector<double> rightBest;
+	SolveLayers(numPositions, leftIntervals, [this, firstBin](int b1, int b2, int& count, double& sum, double& sumSquare) {
+		count = binEnd[firstBin + b2] - binEnd[firstBin + b1];
+		sum = sumY[firstBin + b2] - sumY[firstBin + b1];
+		sumSquare = sumYSquare[firstBin + b2] - sumYSquare[firstBin + b1];
+	}, leftBest);
+	//same layers run from the end backwards: rightBest[u] is the best cost of the last u bins in rightIntervals intervals
+	SolveLayers(numPositions, rightIntervals, [this, lastBin](int b1, int b2, int& count, double& sum, double& sumSquare) {
+		count = binEnd[lastBin - b1] - binEnd[lastBin - b2];
+		sum = sumY[lastBin - b1] - sumY[lastBin - b2];
+		sumSquare = sumYSquare[lastBin - b1] - sumYSquare[lastBin - b2];
+	}, rightBest);
+	int split = leftIntervals; double minimumVal = numeric_limits<double>::infinity(); double total = 0;
+	for (int t = leftIntervals; t <= numPositions - rightIntervals; t++) {
+		total = leftBest[t] + rightBest[numPositions - t];
+		if (total < minimumVal) {
+			minimumVal = total;
+			split = t;
 		}
-		merge++;
 	}
-	while (l < leftSubMax) {
-		points[merge] = leftSubArray[l];
-		l++; merge++;
+	leftBest = vector<double>(); rightBest = vector<double>();
+	cuts.push_back(firstBin + split);
+	SplitIntoIntervals(firstBin, firstBin + split, leftIntervals, cuts);
+	SplitIntoIntervals(firstBin + split, lastBin, rightIntervals, cuts);
+}
+
+//best[t] = least error of positions 1..t split into exactly the given number of layers (intervals), infinity where that is impossible
+//segmentSums(a, b, ...) gives the point count, sum of y and sum of y squared of positions a+1..b
+//
+//pruning works on the interval mean mu (functional pruning, as in pDPA): the cost of ending the last interval at t after a start s is
+//OPT_L-1(s) + sum of (y - mu)^2, a quadratic in mu, and the layer's answer is the lowest point of the lowest of those quadratics
+//every quadratic grows by the same amount as t moves on, so once a start is beaten by a later one for every mu it is beaten for good
+//pieces keeps, in order of mu, which start is lowest where - a start that no longer owns any piece is never looked at again
+template <class SegmentSums>
+void Grid::SolveLayers(int numPositions, int layers, SegmentSums segmentSums, vector<double>& best) {
+	const double infinity = numeric_limits<double>::infinity();
+	int count = 0; double sum = 0; double sumSquare = 0; double average = 0; double error = 0;
+	auto errorOf = [&]() {
+		GRID_STATS(stats.errorEvaluations++);
+		average = sum / count;
+		error = sumSquare - count * average * average;
+		return (error < 0) ? 0 : error;
+	};
+	best.assign(numPositions + 1, infinity);
+	//the mean of any interval lies between the lowest and highest mean of a single position, so mu never has to leave that range
+	double lowest = infinity; double highest = -infinity;
+	for (int t = 1; t <= numPositions; t++) {
+		segmentSums(t - 1, t, count, sum, sumSquare);
+		lowest = min(lowest, sum / count);
+		highest = max(highest, sum / count);
+		segmentSums(0, t, count, sum, sumSquare);
+		best[t] = errorOf();
 	}
-	while (r < rightSubMax) {
-		points[merge] = rightSubArray[r];
-		r++; merge++;
+	vector<double> next;
+	vector<meanPiece>& pieces = arena.pieces; vector<meanPiece>& updated = arena.updatedPieces;
+	double minimumVal = 0; double newCost = 0; double constant = 0; double discriminant = 0; double keepFrom = 0; double keepTo = 0;
+	for (int layer = 2; layer <= layers; layer++) {
+		next.assign(numPositions + 1, infinity);
+		pieces.assign(1, { lowest, highest, layer - 1 });
+		for (int t = layer; t <= numPositions; t++) {
+			//start t-1 joins with cost OPT_L-1(t-1) for every mu - it takes over wherever an older start's quadratic is above that
+			if (t > layer) {
+				newCost = best[t - 1];
+				updated.clear();
+				for (size_t p = 0; p < pieces.size(); p++) {
+					segmentSums(pieces[p].start, t - 1, count, sum, sumSquare);
+					//older start keeps the mu where count*mu^2 - 2*sum*mu + sumSquare + OPT(start) <= newCost, with a little slack so
+					//rounding can only ever keep a start too long, never drop one too early
+					constant = sumSquare + best[pieces[p].start] - newCost - 1e-9 * (1.0 + abs(newCost));
+					discriminant = sum * sum - count * constant;
+					keepFrom = infinity; keepTo = -infinity;
+					if (discriminant >= 0) {
+						keepFrom = (sum - sqrt(discriminant)) / count;
+						keepTo = (sum + sqrt(discriminant)) / count;
+					}
+					keepFrom = max(keepFrom, pieces[p].from);
+					keepTo = min(keepTo, pieces[p].to);
+					if (keepFrom > keepTo) {
+						AppendPiece(updated, { pieces[p].from, pieces[p].to, t - 1 });
+						continue;
+					}
+					if (pieces[p].from < keepFrom) AppendPiece(updated, { pieces[p].from, keepFrom, t - 1 });
+					AppendPiece(updated, { keepFrom, keepTo, pieces[p].start });
+					if (keepTo < pieces[p].to) AppendPiece(updated, { keepTo, pieces[p].to, t - 1 });
+				}
+				swap(pieces, updated);
+			}
+			minimumVal = infinity;
+			for (size_t p = 0; p < pieces.size(); p++) {
+				if (p > 0 && pieces[p].start == pieces[p - 1].start) continue;
+				segmentSums(pieces[p].start, t, count, sum, sumSquare);
+				minimumVal = min(minimumVal, best[pieces[p].start] + errorOf());
+			}
+			next[t] = minimumVal;
+		}
+		swap(best, next);
 	}
 }
 
+//add a piece to the end of a mean piece list, merging it into the last piece when both belong to the same start
+void Grid::AppendPiece(vector<meanPiece>& pieces, meanPiece piece) {
+	if (!pieces.empty() && pieces.back().start == piece.start) pieces.back().to = piece.to;
+	else pieces.push_back(piece);
+}
+
 //use stopwatch to measure the time it takes to run the partitioning algorithm
-double Grid::TimeToFindDivisions(bool tabulation) {
+double Grid::TimeToFindDivisions(SolverType solver) {
 	chrono::steady_clock::time_point start = chrono::steady_clock::now();
-	if (tabulation) FindOptimalPartitionings_Tabulation();
-	else FindOptimalPartitionings_Memoization();
+	FindOptimalPartitionLines(solver);
 	chrono::steady_clock::time_point end = chrono::steady_clock::now();
 	chrono::duration<float> timeSpent = chrono::duration_cast<chrono::duration<double>>(end - start);
 	return timeSpent.count();
 }
 
+//seconds since the last call - each phase of a solve is timed by lapping once before it starts and once after it ends
+double Grid::LapPhase() {
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	double seconds = chrono::duration<double>(now - phaseStart).count();
+	phaseStart = now;
+	return seconds;
+}
+
+//capacity in bytes of every buffer the solvers fill, always in the same order, so two snapshots can be compared buffer by buffer
+array<size_t, 17> Grid::BufferCapacities() {
+	return { sumY.capacity() * sizeof(double), sumYSquare.capacity() * sizeof(double), binX.capacity() * sizeof(int),
+		binEnd.capacity() * sizeof(int), lastSegmentStart.capacity() * sizeof(int), partitionLines.capacity() * sizeof(int),
+		arena.OPT.capacity() * sizeof(double), arena.solved.capacity() * sizeof(char), arena.stack.capacity() * sizeof(memoFrame),
+		arena.candidates.capacity() * sizeof(int), arena.candidateCosts.capacity() * sizeof(double),
+		arena.chunkMinimum.capacity() * sizeof(double), arena.chunkStart.capacity() * sizeof(int),
+		arena.pieces.capacity() * sizeof(meanPiece), arena.updatedPieces.capacity() * sizeof(meanPiece),
+		arena.sortScratch.capacity() * sizeof(point), arena.sortCounts.capacity() * sizeof(int) };
+}
+
+//count every buffer that grew since the snapshot as one allocation of its new size - buffers only ever grow, so a solve that
+//reuses the buffers of the last one counts nothing
+void Grid::CountBufferGrowth(const array<size_t, 17>& before) {
+	array<size_t, 17> after = BufferCapacities();
+	for (unsigned int i = 0; i < after.size(); i++) {
+		if (after[i] <= before[i]) continue;
+		stats.allocations++;
+		stats.bytesAllocated += after[i];
+	}
+}
+
+const Grid::solveStats& Grid::GetStats() {
+	return stats;
+}
+
+void Grid::ResetStats() {
+	stats = solveStats();
+}
+
 //returns the info for the point set as a string of (x_1, y_1) (x_2, y_2) etc
 string Grid::GetPointInfo() {
 	if (points.size() == 0) return "No points in grid.";
@@ -218,6 +894,26 @@ void Grid::SetPenalty(double newPenalty) {
 	penalty = newPenalty;
 }
 
+int Grid::GetThreadCount() {
+	return threadCount;
+}
+
+//number of threads used by the parallel solvers - the worker threads are created here once and kept for every later solve
+void Grid::SetThreadCount(int threads) {
+	if (threads < 1) threads = 1;
+	if (threads == threadCount && (pool || threads == 1)) return;
+	threadCount = threads;
+	pool = (threads > 1) ? make_shared<ThreadPool>(threads) : nullptr;
+}
+
+Grid::SummationMode Grid::GetSummationMode() {
+	return summationMode;
+}
+
+void Grid::SetSummationMode(SummationMode mode) {
+	summationMode = mode;
+}
+
 int Grid::GetNumPoints() {
 	return static_cast<int>(points.size());
 }
@@ -6,49 +6,383 @@
 #include <string>
 #include <chrono> 
 #include <list>
-#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <array>
+#include <type_traits>
+#include <cmath>
+#include "ThreadPool.h"
 
 using namespace std;
 
+class PointFile;
+class PiecewiseModel;
+struct squaredErrorCost;
+
+//build with GRID_ENABLE_STATS defined to have the solvers fill in Grid::GetStats - without it every GRID_STATS(...) statement
+//disappears at compile time, so the hot loops are exactly the same as before and GetStats just stays zero
+#ifdef GRID_ENABLE_STATS
+#define GRID_STATS(...) __VA_ARGS__
+#else
+#define GRID_STATS(...)
+#endif
+
+//running sum with Neumaier compensation - carries the rounding error of every addition so long prefix sums don't drift
+struct CompensatedSum {
+	double sum = 0.0;
+	double compensation = 0.0;
+
+	void Add(double value) {
+		double total = sum + value;
+		if (abs(sum) >= abs(value)) compensation += (sum - total) + value;
+		else compensation += (value - total) + sum;
+		sum = total;
+	}
+	double Total() const { return sum + compensation; }
+};
+
 class Grid {
+public:
+	enum class SolverType { Tabulation, Memoization, Pruned, Binned, ParallelTabulation };
+	enum class SummationMode { Standard, Compensated, LongDouble };
 
+	//weight only matters to the weighted cost policy (see CostPolicies.h) and isn't part of what makes two points the same
+	//it's kept as a float so it sits in the padding after x, and a point stays 16 bytes
 	struct point {
 		int x;
+		float weight;
 		double y;
 
+		point() : x(0), weight(1.0f), y(0.0) {}
+		point(int newX, double newY, double newWeight = 1.0) : x(newX), weight(static_cast<float>(newWeight)), y(newY) {}
+
 		bool operator==(const point& p) const
 		{
 			return (x == p.x && y == p.y);
 		}
 	};
 
+	//one distinct optimal partitioning on a penalty path, and the range of penalties it is optimal for
+	//error is the total approximation error without any penalty, intervals the number of interval elements
+	struct penaltyPathEntry {
+		double minimumPenalty;
+		double maximumPenalty;
+		int intervals;
+		double error;
+		vector<int> partitionLines;
+	};
+
+	//what the approximate solver found: its division lines, their total cost (error plus the penalty of every interval after the
+	//first) and a lower bound on the cost of the best binned partitioning - the optimum lies in [lowerBound, cost], so the answer is
+	//at most cost / lowerBound - 1 worse than optimal; positions is how many cut positions the finest DP chose between
+	struct approximatePartitioning {
+		vector<int> partitionLines;
+		double cost;
+		double lowerBound;
+		int positions;
+	};
+
+	//what the solvers have been doing since the grid was made (or ResetStats) - only filled in with GRID_ENABLE_STATS
+	//times are in seconds and, like the counters, add up over every solve; segments is the interval count of the last solve
+	//allocations and bytesAllocated count every time the sort's or a solver's buffer had to grow
+	struct solveStats {
+		unsigned long long solves = 0;
+		double sortTime = 0.0;
+		double precomputeTime = 0.0;
+		double solveTime = 0.0;
+		double partitionTime = 0.0;
+		unsigned long long errorEvaluations = 0;
+		unsigned long long candidatesPruned = 0;
+		unsigned long long allocations = 0;
+		unsigned long long bytesAllocated = 0;
+		int segments = 0;
+	};
+
+	//where the sorted points being solved live - the grid's own points, or the columns of a mapped point file
+	//x, y and weight are read through a byte stride so the same code walks an array of points and separate columns
+	//cost policies are handed one of these to build their sums from - a source without a weight column has every weight 1
+	struct pointColumns {
+		const char* x = nullptr;
+		const char* y = nullptr;
+		size_t xStride = 0;
+		size_t yStride = 0;
+		const char* weight = nullptr;
+		size_t weightStride = 0;
+
+		int X(int i) const { return *reinterpret_cast<const int*>(x + i * xStride); }
+		double Y(int i) const { return *reinterpret_cast<const double*>(y + i * yStride); }
+		double Weight(int i) const { return (weight) ? *reinterpret_cast<const float*>(weight + i * weightStride) : 1.0; }
+	};
+
+private:
+	//the batch and out of core solvers load each series or chunk straight into a grid of their own, skipping the duplicate check
+	//index (see BatchSolver.cpp and ChunkedSolver.cpp)
+	friend class BatchSolver;
+	friend class ChunkedSolver;
+
+	//hash on (x, y) for the point index - 0.0 and -0.0 compare equal so they have to hash the same as well
+	struct pointHash {
+		size_t operator()(const point& p) const
+		{
+			double y = (p.y == 0.0) ? 0.0 : p.y;
+			unsigned long long bits = 0;
+			memcpy(&bits, &y, sizeof(bits));
+			bits ^= static_cast<unsigned long long>(static_cast<unsigned int>(p.x)) * 0x9E3779B97F4A7C15ULL;
+			bits ^= bits >> 31; bits *= 0xBF58476D1CE4E5B9ULL; bits ^= bits >> 29;
+			return static_cast<size_t>(bits);
+		}
+	};
+
+	//one pending OPT(i) of the top-down method: how far through the candidate starts j it has got, and the best found so far
+	struct memoFrame {
+		int i;
+		int j;
+		double minimumVal;
+		int tempPartitioning;
+	};
+
+	//an interval [from, to] of candidate interval means mu on which the last interval starting at position start is the cheapest choice
+	struct meanPiece {
+		double from;
+		double to;
+		int start;
+	};
+
+	//scratch memory for the solvers - kept on the grid and only ever grown, so solving the same grid again doesn't allocate
+	struct solverArena {
+		vector<double> OPT;
+		vector<char> solved;
+		vector<memoFrame> stack;
+		vector<int> candidates;
+		vector<double> candidateCosts;
+		vector<double> chunkMinimum;
+		vector<int> chunkStart;
+		vector<meanPiece> pieces;
+		vector<meanPiece> updatedPieces;
+		vector<point> sortScratch;
+		vector<int> sortCounts;
+	};
+
 	bool PointsContains(point p);
+	static bool HasValidWeight(const point& p);
 	void PrecomputeErrorSums(int xMax);
 	double CalculateError(int x1, int x2);
-	double MemoizationHelper(unordered_map<int, double>& OPT, unordered_map<int, list<int>>& partitionings, int i);
-	void SortPoints(vector<point>& points, int left, int right);
-	void Merge(vector<point>& points, int left, int middle, int right);
+	int PrecomputeBinnedErrorSums(int numPoints);
+	double CalculateBinnedError(int b1, int b2);
+	void SolveTabulation(int numPoints, const double* sums, const double* sumSquares);
+	void SolveParallelTabulation(int numPoints);
+	template <class ErrorFunction>
+	void SolveTabulation(int numPoints, ErrorFunction calculateError);
+	template <class ErrorFunction>
+	void SolveMemoization(int numPoints, ErrorFunction calculateError);
+	template <class ErrorFunction>
+	void SolvePruned(int numPoints, ErrorFunction calculateError);
+	int PrecomputeBins(int numPoints);
+	int PreparePoints();
+	void SolveSource(int numPoints, SolverType solver);
+	void BuildPartitionLines(int numPoints, bool binned = false);
+	bool FitSource(int numPoints, const vector<int>& lines, PiecewiseModel& model);
+	penaltyPathEntry SolveBinnedForPenalty(int numBins, double newPenalty);
+	double SolveBinnedPositions(const vector<int>& positions, vector<int>& cuts);
+	double CalculateLowerBound(const vector<int>& positions);
+	void BoundBlock(int firstBin, int lastBin, double& whole, double& divided);
+	template <class SegmentSums>
+	void SolveLayers(int numPositions, int layers, SegmentSums segmentSums, vector<double>& best);
+	void SplitIntoIntervals(int firstBin, int lastBin, int intervals, vector<int>& cuts);
+	void AppendPiece(vector<meanPiece>& pieces, meanPiece piece);
+	void SortPoints();
+	double LapPhase();
+	array<size_t, 17> BufferCapacities();
+	void CountBufferGrowth(const array<size_t, 17>& before);
 	vector<point> points;
+	pointColumns source;
+	unordered_set<point, pointHash> pointIndex;
 	double penalty;
+	SummationMode summationMode;
 	vector<vector<int>> numPoints;
 	vector<double> sumY;
 	vector<double> sumYSquare;
+	vector<int> binX;
+	vector<int> binEnd;
 	int largestX;
+	vector<int> lastSegmentStart;
+	vector<int> partitionLines;
+	solverArena arena;
+	int threadCount;
+	shared_ptr<ThreadPool> pool;
+	solveStats stats;
+	chrono::steady_clock::time_point phaseStart;
 
 public:
-	list<int> partitionLines;
-
 	Grid();
-	bool AddPoint(int x, double y);
+	bool AddPoint(int x, double y, double weight = 1.0);
+	int AddPoints(const point* newPoints, size_t count);
+	int AddPoints(const vector<point>& newPoints);
 	void AddRandomPoints(int numberPoints, int maxVal);
+	void AddRandomPoints(int numberPoints, int maxVal, unsigned long long seed);
+	const vector<int>& FindOptimalPartitionLines(SolverType solver = SolverType::Tabulation);
+	const vector<int>& FindOptimalPartitionLines(const PointFile& file, SolverType solver = SolverType::Tabulation);
+	template <class CostPolicy>
+	const vector<int>& FindOptimalPartitionLinesWithCost(CostPolicy& cost, SolverType solver = SolverType::Pruned);
+	bool FitModel(const vector<int>& lines, PiecewiseModel& model);
+	bool FitModel(const PointFile& file, const vector<int>& lines, PiecewiseModel& model);
 	list<int> FindOptimalPartitionings_Tabulation();
 	list<int> FindOptimalPartitionings_Memoization();
-	double TimeToFindDivisions(bool tabulation = true);
+	list<int> FindOptimalPartitionings_Pruned();
+	list<int> FindOptimalPartitionings_Binned();
+	const vector<int>& FindPartitionLinesForIntervals(int intervals);
+	list<int> FindOptimalPartitionings_K(int intervals);
+	vector<penaltyPathEntry> FindPenaltyPath(double minimumPenalty, double maximumPenalty);
+	approximatePartitioning FindApproximatePartitioning(int blockSize = 1024, int refineWindow = 2);
+	double TimeToFindDivisions(SolverType solver = SolverType::Tabulation);
 	double GetPenalty();
 	void SetPenalty(double newPenalty);
+	SummationMode GetSummationMode();
+	void SetSummationMode(SummationMode mode);
+	int GetThreadCount();
+	void SetThreadCount(int threads);
+	const solveStats& GetStats();
+	void ResetStats();
 	string GetPointInfo();
 	int GetNumPoints();
 	int GetMaxXVal();
 
 };
+
+//the solver templates live here rather than in Grid.cpp so a cost policy defined anywhere can be plugged into them
+
+//find the optimal partitioning with the error of an interval given by a cost policy instead of the built in squared error
+//a policy is any type with
+//    void Prepare(const Grid::pointColumns& points, int numPoints)  - build what it needs for the first numPoints sorted points
+//    double Error(int a, int b)                                     - the error of sorted points a+1..b (positions a..b-1)
+//the solvers call Error directly, so it's inlined into their loops - there is no virtual call anywhere in them
+//the pruned and binned methods rely on splitting an interval never increasing its error, which all the policies in CostPolicies.h
+//satisfy; ParallelTabulation runs as plain Tabulation, and squaredErrorCost with Tabulation goes through the vectorized kernel
+template <class CostPolicy>
+const vector<int>& Grid::FindOptimalPartitionLinesWithCost(CostPolicy& cost, SolverType solver) {
+	int numPoints = PreparePoints();
+	partitionLines.clear();
+	if (numPoints == 0) return partitionLines;
+	cost.Prepare(source, numPoints);
+	auto calculateError = [&](int a, int b) {
+		GRID_STATS(stats.errorEvaluations++);
+		return cost.Error(a, b);
+	};
+	if (solver == SolverType::Binned) {
+		int numBins = PrecomputeBins(numPoints);
+		lastSegmentStart.assign(numBins + 1, 0);
+		SolvePruned(numBins, [&](int b1, int b2) { return calculateError(binEnd[b1], binEnd[b2]); });
+		BuildPartitionLines(numBins, true);
+		return partitionLines;
+	}
+	lastSegmentStart.assign(numPoints + 1, 0);
+	if (solver == SolverType::Memoization) SolveMemoization(numPoints, calculateError);
+	else if (solver == SolverType::Pruned) SolvePruned(numPoints, calculateError);
+	else if constexpr (is_same<CostPolicy, squaredErrorCost>::value) SolveTabulation(numPoints, cost.sumY.data(), cost.sumYSquare.data());
+	else SolveTabulation(numPoints, calculateError);
+	BuildPartitionLines(numPoints);
+	return partitionLines;
+}
+
+//bottom-up fill of OPT for the first i points, i = 1..n, for any error function - the plain loop over every start j-1
+template <class ErrorFunction>
+void Grid::SolveTabulation(int numPoints, ErrorFunction calculateError) {
+	vector<double>& OPT = arena.OPT;
+	OPT.assign(numPoints + 1, 0.0);
+	double tempMinimum = 0; double minimumVal = 0; int tempPartitioning = 0;
+	for (int i = 1; i <= numPoints; i++) {
+		minimumVal = calculateError(0, i);
+		tempPartitioning = 0;
+		for (int j = 1; j <= i; j++) {
+			tempMinimum = calculateError(j - 1, i) + OPT[j - 1] + penalty;
+			if (tempMinimum <= minimumVal) {
+				minimumVal = tempMinimum;
+				tempPartitioning = j - 1;
+			}
+		}
+		OPT[i] = minimumVal;
+		lastSegmentStart[i] = tempPartitioning;
+	}
+}
+
+//top-down fill of OPT(n): same Bellman equation as in bottom-up method, but a value is only calculated once some OPT(i) asks for it
+//instead of recursing, pending values wait on an explicit stack, so deep point sets can't overflow the call stack
+template <class ErrorFunction>
+void Grid::SolveMemoization(int numPoints, ErrorFunction calculateError) {
+	vector<double>& OPT = arena.OPT;
+	vector<char>& solved = arena.solved;
+	vector<memoFrame>& stack = arena.stack;
+	OPT.assign(numPoints + 1, 0.0);
+	solved.assign(numPoints + 1, 0);
+	solved[0] = 1;
+	//a frame only waits on one smaller i at a time, so the stack can never hold more than numPoints frames
+	stack.clear();
+	stack.reserve(numPoints + 1);
+	if (numPoints > 0) stack.push_back({ numPoints, 1, calculateError(0, numPoints), 0 });
+	double tempMinimum = 0.0;
+	while (!stack.empty()) {
+		memoFrame& frame = stack.back();
+		//walk the candidate starts in the same order as the bottom-up loop so ties are broken identically
+		while (frame.j <= frame.i && solved[frame.j - 1]) {
+			tempMinimum = calculateError(frame.j - 1, frame.i) + OPT[frame.j - 1] + penalty;
+			if (tempMinimum <= frame.minimumVal) {
+				frame.minimumVal = tempMinimum;
+				frame.tempPartitioning = frame.j - 1;
+			}
+			frame.j++;
+		}
+		//OPT(j-1) hasn't been needed before now - park this frame and work out that value first
+		if (frame.j <= frame.i) {
+			int needed = frame.j - 1;
+			stack.push_back({ needed, 1, calculateError(0, needed), 0 });
+		}
+		else {
+			OPT[frame.i] = frame.minimumVal;
+			lastSegmentStart[frame.i] = frame.tempPartitioning;
+			solved[frame.i] = 1;
+			stack.pop_back();
+		}
+	}
+}
+
+//bottom-up fill of OPT that only scans the starts of the last segment still able to win
+//numPoints is the number of DP positions and calculateError(a, b) the error of positions a+1..b - points, or x bins for the binned method
+template <class ErrorFunction>
+void Grid::SolvePruned(int numPoints, ErrorFunction calculateError) {
+	vector<double>& OPT = arena.OPT;
+	OPT.assign(numPoints + 1, 0.0);
+	//candidates holds the starts s > 0 that might still begin the optimal last segment, in increasing order
+	//start 0 (no division at all) is always evaluated directly, exactly as the j = 1 case of the tabulation loop
+	vector<int>& candidates = arena.candidates; vector<double>& candidateCosts = arena.candidateCosts;
+	candidates.clear(); candidates.reserve(numPoints);
+	double tempMinimum = 0; double minimumVal = 0; int tempPartitioning = 0;
+	for (int i = 1; i <= numPoints; i++) {
+		minimumVal = calculateError(0, i);
+		tempPartitioning = 0;
+		tempMinimum = minimumVal + OPT[0] + penalty;
+		if (tempMinimum <= minimumVal) minimumVal = tempMinimum;
+		candidateCosts.resize(candidates.size());
+		//scan in increasing order with <= so ties resolve to the latest start, same as the unpruned loop
+		for (size_t c = 0; c < candidates.size(); c++) {
+			candidateCosts[c] = calculateError(candidates[c], i) + OPT[candidates[c]];
+			tempMinimum = candidateCosts[c] + penalty;
+			if (tempMinimum <= minimumVal) {
+				minimumVal = tempMinimum;
+				tempPartitioning = candidates[c];
+			}
+		}
+		OPT[i] = minimumVal;
+		lastSegmentStart[i] = tempPartitioning;
+		//splitting an interval never increases its error, so if OPT(s) + error(s, i) is already worse than OPT(i),
+		//starting the last segment at i instead of s is at least as good for every later end point - drop s for good
+		size_t kept = 0;
+		for (size_t c = 0; c < candidates.size(); c++) {
+			if (candidateCosts[c] <= OPT[i]) candidates[kept++] = candidates[c];
+		}
+		GRID_STATS(stats.candidatesPruned += candidates.size() - kept);
+		candidates.resize(kept);
+		candidates.push_back(i);
+	}
+}
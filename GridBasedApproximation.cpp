@@ -13,6 +13,8 @@
 #include <sstream>
 #include <iomanip>
 #include "Grid.h"
+#include "PointFile.h"
+#include "PiecewiseModel.h"
 using namespace std;
 
 void progInteractions();
@@ -20,12 +22,14 @@ void reset();
 void badResponse();
 void handleInitialSetupResponses(int response);
 void handlePointInput();
+void loadPointText();
 template <class T>
 bool setValIfValid(T amount, T* var, T minimum);
 void manualOrAutomatic(int response);
 void getBestPartitioning();
-void timeAnalysis(bool tabulation);
+void timeAnalysis(Grid::SolverType solver);
 void timeAnalysisSingle();
+void speedupAnalysis();
 void runtimeResponse(int response);
 void runtimeComplexityInteraction();
 bool checkAllNumerical(string str, char delimiter, int expectedNumericalPieces);
@@ -164,13 +168,18 @@ bool setValIfValid(T amount, T* var, T minimum) {
     }    
 }
 
-//if the user wants to run time complexity experiments, they can choose to run them with either the tabulation or memoization based functions
+//if the user wants to run time complexity experiments, they can choose to run them with the tabulation, memoization, pruned or binned based functions
 void runtimeComplexityInteraction() {
     int resp;
-    cout << "What settings would you like to complete the experimental analysis with?\n1: Bottom-up / Tabulation type programming\n2: Top-down / Memoization type programming" << endl;
+    Grid::SolverType solvers[4] = { Grid::SolverType::Tabulation, Grid::SolverType::Memoization, Grid::SolverType::Pruned, Grid::SolverType::Binned };
+    cout << "What settings would you like to complete the experimental analysis with?\n1: Bottom-up / Tabulation type programming\n2: Top-down / Memoization type programming\n3: Bottom-up with pruning of candidate intervals (PELT)\n4: Pruned bottom-up over distinct x values (binned)\n5: Multi-threaded bottom-up speedup for increasing thread counts" << endl;
     cin >> resp;
-    if (resp == 1 || resp == 2) {
-        timeAnalysis(resp == 1);
+    if (resp >= 1 && resp <= 4) {
+        timeAnalysis(solvers[resp - 1]);
+        reset();
+    }
+    else if (resp == 5) {
+        speedupAnalysis();
         reset();
     }
     else badResponse();
@@ -179,7 +188,7 @@ void runtimeComplexityInteraction() {
 //allow users to manyally add points to the set. points are 2D, x = integer > 1 and y = real number.
 void handlePointInput() {
     cout << "Please now enter the information for each point you wish to add one by one in the form 'x,y'. Note that x must be a positive integer." << endl;
-    cout << "When you have finished adding points, enter 'q' to exit this stage." << endl;
+    cout << "When you have finished adding points, enter 'q' to exit this stage. To add every point in a text file of 'x,y' lines, enter 'f'." << endl;
 
     string response = "";
     int x = 0; double y = 0;
@@ -189,6 +198,10 @@ void handlePointInput() {
             cout << "Point generation complete. Total of " << grid.GetNumPoints() << " points added." << endl;
             return;
         }
+        if (response == "f" || response == "F") {
+            loadPointText();
+            continue;
+        }
         vector<string> pieces = getSplitString(response, ',');
         //check we have both values + no more
         if (pieces.size() != 2) badResponse();
@@ -211,6 +224,20 @@ void handlePointInput() {
     }
 }
 
+//read a whole text file of points in one go - much faster than typing them, and the same rules for what counts as a point
+void loadPointText() {
+    cout << "Please enter the path of the file to load." << endl;
+    string path = "";
+    cin >> path;
+    vector<Grid::point> loaded; string error = "";
+    if (!ReadPointText(path, loaded, error, static_cast<int>(thread::hardware_concurrency()))) {
+        cout << "Could not load points: " << error << endl;
+        return;
+    }
+    int added = grid.AddPoints(loaded);
+    cout << added << " points added (" << loaded.size() - added << " already in grid). Please add more points or enter 'q' to complete point generation." << endl;
+}
+
 //split string based on given delimiter (used to split up point info on commas)
 vector<string> getSplitString(string str, char delimiter) {
     stringstream ss(str); string piece;
@@ -241,7 +268,7 @@ void getBestPartitioning() {
         return;
     }
 
-    list<int> partitioning = grid.FindOptimalPartitionings_Memoization();
+    const vector<int>& partitioning = grid.FindOptimalPartitionLines(Grid::SolverType::Memoization);
     cout << "The best 2D partitioning has been found! Here are its intervals:"<< endl;
     //if there are no partitions, the original [1,m] interval was not broken up
     if (partitioning.size() == 0) {
@@ -250,8 +277,8 @@ void getBestPartitioning() {
     //otherwise iterate through the partitions and form interval notation
     //handle start and end partitions separate to account for the [1,m] boundaries
     else {
-        list<int>::iterator iterAhead = partitioning.begin();
-        list<int>::iterator iter = partitioning.begin();
+        vector<int>::const_iterator iterAhead = partitioning.begin();
+        vector<int>::const_iterator iter = partitioning.begin();
         iterAhead++;
         int intervalEnd = 0; int intervalStart = 0;
         intervalEnd = (*iter == 1) ? 1 : *iter - 1;
@@ -263,6 +290,12 @@ void getBestPartitioning() {
         }
         cout << "[" << *iter << ", "<< grid.GetMaxXVal() << "]" << endl;
     }
+    //the value each interval's points are approximated by, in the same order
+    PiecewiseModel model;
+    grid.FitModel(partitioning, model);
+    cout << "Approximating values:";
+    for (int i = 0; i < model.GetNumSegments(); i++) cout << " " << model.GetMeans()[i];
+    cout << endl;
 }
 
 //show user all previously set information for their current point set
@@ -273,8 +306,9 @@ void viewInfo(Grid grid) {
 
 //automatic time analysis - used to generate data that can be used to 
 //experiementally prove the run time O(n^2) for the dynamic programming algorithm in Grid.cpp
-void timeAnalysis(bool tabulation) {
-    string DPType = (tabulation) ? "bottom-up / tabulation" : "top-down / memoization";
+void timeAnalysis(Grid::SolverType solver) {
+    string DPTypes[5] = { "bottom-up / tabulation", "top-down / memoization", "pruned bottom-up", "binned pruned bottom-up", "multi-threaded bottom-up" };
+    string DPType = DPTypes[static_cast<int>(solver)];
     cout << "Timing finding the best partitioning of intervals for point sets up to size n = 5,000 with a penalty of -10 for each additional partition and a maximum x value of any point m = 5,000 using a " << DPType << " method, please wait..." << endl;
     cout << "======================" << endl;
     double time = 0; int numPoints;
@@ -284,7 +318,7 @@ void timeAnalysis(bool tabulation) {
         cout << "Time to find partitioning for point sets of size n = " << numPoints << " points: " << endl;
         for (int j = 0; j < 10; j++) {
             grid.AddRandomPoints(i, 5000); 
-            time = grid.TimeToFindDivisions(tabulation);
+            time = grid.TimeToFindDivisions(solver);
             cout << fixed;
             cout << setprecision(9);
             cout << time << endl;
@@ -302,5 +336,27 @@ void timeAnalysisSingle() {
     cout << "Time to find optimum partitioning for this point set: " << time << " seconds" << endl;
 }
 
-
-
+//speedup curve for the multi-threaded bottom-up method
+//the same point set is solved with 1, 2, 4, ... threads up to the number of cores, and each time is compared against the 1 thread time
+void speedupAnalysis() {
+    int numPoints = 20000;
+    int maxThreads = static_cast<int>(thread::hardware_concurrency());
+    if (maxThreads < 1) maxThreads = 1;
+    cout << "Timing the multi-threaded bottom-up method on a point set of size n = " << numPoints << " for up to " << maxThreads << " threads, please wait..." << endl;
+    cout << "======================" << endl;
+    Grid grid = Grid();
+    grid.AddRandomPoints(numPoints, numPoints);
+    double baseTime = 0; double time = 0;
+    cout << fixed;
+    cout << setprecision(9);
+    for (int threads = 1; threads <= maxThreads; threads = (threads * 2 > maxThreads && threads != maxThreads) ? maxThreads : threads * 2) {
+        grid.SetThreadCount(threads);
+        //median of 5 runs so a single slow run doesn't skew the curve
+        vector<double> times;
+        for (int j = 0; j < 5; j++) times.push_back(grid.TimeToFindDivisions(Grid::SolverType::ParallelTabulation));
+        sort(times.begin(), times.end());
+        time = times[2];
+        if (threads == 1) baseTime = time;
+        cout << "threads: " << threads << "\ttime: " << time << " seconds\tspeedup: " << setprecision(2) << baseTime / time << "x" << setprecision(9) << endl;
+    }
+}
@@ -0,0 +1,164 @@
+#include "Kernels.h"
+#include <atomic>
+#include <limits>
+
+//the vector paths have to round exactly like the scalar one, so a multiply followed by a subtract must never be fused into an fma
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GRID_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//reference path - exactly the loop body of the bottom-up method with CalculateError written out
+static void FindBestSegmentStartScalar(const double* sumY, const double* sumYSquare, const double* OPT, double penalty,
+	int i, int first, int last, double& minimumVal, int& tempPartitioning) {
+	double tempMinimum = 0.0;
+	for (int s = first; s < last; s++) {
+		int pointsInCell = i - s;
+		double sumYInCell = (sumY[i] - sumY[s]);
+		double average = (pointsInCell == 0) ? 0 : sumYInCell / pointsInCell;
+		double error = (sumYSquare[i] - sumYSquare[s]) - pointsInCell * average * average;
+		error = (error < 0) ? 0 : error;
+		tempMinimum = error + OPT[s] + penalty;
+		if (tempMinimum <= minimumVal) {
+			minimumVal = tempMinimum;
+			tempPartitioning = s;
+		}
+	}
+}
+
+//fold the per lane results into the running minimum
+//each lane holds the latest start reaching that lane's minimum, so the overall answer is the latest start among the lanes tied for the
+//smallest value - which is exactly where a sequential <= scan over the same starts would have ended up
+static void MergeLanes(const double* laneMinimum, const double* laneStart, int lanes, double& minimumVal, int& tempPartitioning) {
+	double vectorMinimum = numeric_limits<double>::infinity(); double vectorStart = -1.0;
+	for (int lane = 0; lane < lanes; lane++) {
+		if (laneStart[lane] < 0) continue;
+		if (vectorStart < 0 || laneMinimum[lane] < vectorMinimum || (laneMinimum[lane] == vectorMinimum && laneStart[lane] > vectorStart)) {
+			vectorMinimum = laneMinimum[lane];
+			vectorStart = laneStart[lane];
+		}
+	}
+	if (vectorStart >= 0 && vectorMinimum <= minimumVal) {
+		minimumVal = vectorMinimum;
+		tempPartitioning = static_cast<int>(vectorStart);
+	}
+}
+
+#ifdef GRID_X86_KERNELS
+__attribute__((target("avx2")))
+static void FindBestSegmentStartAVX2(const double* sumY, const double* sumYSquare, const double* OPT, double penalty,
+	int i, int first, int last, double& minimumVal, int& tempPartitioning) {
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d endSumY = _mm256_set1_pd(sumY[i]);
+	const __m256d endSumYSquare = _mm256_set1_pd(sumYSquare[i]);
+	const __m256d penaltyVec = _mm256_set1_pd(penalty);
+	const __m256d endIndex = _mm256_set1_pd(static_cast<double>(i));
+	const __m256d step = _mm256_set1_pd(4.0);
+	__m256d bestVal = _mm256_set1_pd(numeric_limits<double>::infinity());
+	__m256d bestStart = _mm256_set1_pd(-1.0);
+	__m256d start = _mm256_setr_pd(first, first + 1.0, first + 2.0, first + 3.0);
+	int s = first;
+	for (; s + 4 <= last; s += 4) {
+		//start indices are small integers, so i - s is exact in double just like the scalar int to double conversion
+		__m256d pointsInCell = _mm256_sub_pd(endIndex, start);
+		__m256d average = _mm256_div_pd(_mm256_sub_pd(endSumY, _mm256_loadu_pd(sumY + s)), pointsInCell);
+		__m256d error = _mm256_sub_pd(_mm256_sub_pd(endSumYSquare, _mm256_loadu_pd(sumYSquare + s)),
+			_mm256_mul_pd(_mm256_mul_pd(pointsInCell, average), average));
+		error = _mm256_blendv_pd(error, zero, _mm256_cmp_pd(error, zero, _CMP_LT_OQ));
+		__m256d tempMinimum = _mm256_add_pd(_mm256_add_pd(error, _mm256_loadu_pd(OPT + s)), penaltyVec);
+		__m256d better = _mm256_cmp_pd(tempMinimum, bestVal, _CMP_LE_OQ);
+		bestVal = _mm256_blendv_pd(bestVal, tempMinimum, better);
+		bestStart = _mm256_blendv_pd(bestStart, start, better);
+		start = _mm256_add_pd(start, step);
+	}
+	double laneMinimum[4]; double laneStart[4];
+	_mm256_storeu_pd(laneMinimum, bestVal);
+	_mm256_storeu_pd(laneStart, bestStart);
+	MergeLanes(laneMinimum, laneStart, 4, minimumVal, tempPartitioning);
+	FindBestSegmentStartScalar(sumY, sumYSquare, OPT, penalty, i, s, last, minimumVal, tempPartitioning);
+}
+
+__attribute__((target("avx512f")))
+static void FindBestSegmentStartAVX512(const double* sumY, const double* sumYSquare, const double* OPT, double penalty,
+	int i, int first, int last, double& minimumVal, int& tempPartitioning) {
+	const __m512d zero = _mm512_setzero_pd();
+	const __m512d endSumY = _mm512_set1_pd(sumY[i]);
+	const __m512d endSumYSquare = _mm512_set1_pd(sumYSquare[i]);
+	const __m512d penaltyVec = _mm512_set1_pd(penalty);
+	const __m512d endIndex = _mm512_set1_pd(static_cast<double>(i));
+	const __m512d step = _mm512_set1_pd(8.0);
+	__m512d bestVal = _mm512_set1_pd(numeric_limits<double>::infinity());
+	__m512d bestStart = _mm512_set1_pd(-1.0);
+	__m512d start = _mm512_setr_pd(first, first + 1.0, first + 2.0, first + 3.0, first + 4.0, first + 5.0, first + 6.0, first + 7.0);
+	int s = first;
+	for (; s + 8 <= last; s += 8) {
+		__m512d pointsInCell = _mm512_sub_pd(endIndex, start);
+		__m512d average = _mm512_div_pd(_mm512_sub_pd(endSumY, _mm512_loadu_pd(sumY + s)), pointsInCell);
+		__m512d error = _mm512_sub_pd(_mm512_sub_pd(endSumYSquare, _mm512_loadu_pd(sumYSquare + s)),
+			_mm512_mul_pd(_mm512_mul_pd(pointsInCell, average), average));
+		error = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(error, zero, _CMP_LT_OQ), error, zero);
+		__m512d tempMinimum = _mm512_add_pd(_mm512_add_pd(error, _mm512_loadu_pd(OPT + s)), penaltyVec);
+		__mmask8 better = _mm512_cmp_pd_mask(tempMinimum, bestVal, _CMP_LE_OQ);
+		bestVal = _mm512_mask_blend_pd(better, bestVal, tempMinimum);
+		bestStart = _mm512_mask_blend_pd(better, bestStart, start);
+		start = _mm512_add_pd(start, step);
+	}
+	double laneMinimum[8]; double laneStart[8];
+	_mm512_storeu_pd(laneMinimum, bestVal);
+	_mm512_storeu_pd(laneStart, bestStart);
+	MergeLanes(laneMinimum, laneStart, 8, minimumVal, tempPartitioning);
+	FindBestSegmentStartScalar(sumY, sumYSquare, OPT, penalty, i, s, last, minimumVal, tempPartitioning);
+}
+#endif
+
+KernelLevel GetSupportedKernelLevel() {
+#ifdef GRID_X86_KERNELS
+	if (__builtin_cpu_supports("avx512f")) return KernelLevel::AVX512;
+	if (__builtin_cpu_supports("avx2")) return KernelLevel::AVX2;
+#endif
+	return KernelLevel::Scalar;
+}
+
+//the active level is shared by every grid (and every thread solving one), so it's read and written atomically
+static atomic<int>& ActiveKernelLevel() {
+	static atomic<int> level(static_cast<int>(GetSupportedKernelLevel()));
+	return level;
+}
+
+KernelLevel GetKernelLevel() {
+	return static_cast<KernelLevel>(ActiveKernelLevel().load(memory_order_relaxed));
+}
+
+void SetKernelLevel(KernelLevel level) {
+	KernelLevel supported = GetSupportedKernelLevel();
+	if (static_cast<int>(level) > static_cast<int>(supported)) level = supported;
+	ActiveKernelLevel().store(static_cast<int>(level), memory_order_relaxed);
+}
+
+const char* GetKernelLevelName(KernelLevel level) {
+	if (level == KernelLevel::AVX512) return "avx512";
+	if (level == KernelLevel::AVX2) return "avx2";
+	return "scalar";
+}
+
+void FindBestSegmentStart(const double* sumY, const double* sumYSquare, const double* OPT, double penalty,
+	int i, int first, int last, double& minimumVal, int& tempPartitioning) {
+#ifdef GRID_X86_KERNELS
+	KernelLevel level = GetKernelLevel();
+	if (level == KernelLevel::AVX512) {
+		FindBestSegmentStartAVX512(sumY, sumYSquare, OPT, penalty, i, first, last, minimumVal, tempPartitioning);
+		return;
+	}
+	if (level == KernelLevel::AVX2) {
+		FindBestSegmentStartAVX2(sumY, sumYSquare, OPT, penalty, i, first, last, minimumVal, tempPartitioning);
+		return;
+	}
+#endif
+	FindBestSegmentStartScalar(sumY, sumYSquare, OPT, penalty, i, first, last, minimumVal, tempPartitioning);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+//this file holds the vectorized inner loop of the bottom-up method - the minimization over every possible start of the "last segment"
+//the widest instruction set the cpu supports is picked at runtime; every path gives bit-identical results to the scalar one
+
+enum class KernelLevel { Scalar, AVX2, AVX512 };
+
+//scan the starts s = first..last-1 of a last segment ending at point i, in increasing order, and keep the best one the same way the
+//scalar loop does: a start replaces the current minimum when error(s, i) + OPT[s] + penalty <= minimumVal, so ties go to the latest start
+void FindBestSegmentStart(const double* sumY, const double* sumYSquare, const double* OPT, double penalty,
+	int i, int first, int last, double& minimumVal, int& tempPartitioning);
+
+//the level currently used, and a way to cap it (used to compare paths) - asking for more than the cpu supports falls back to the best available
+KernelLevel GetKernelLevel();
+void SetKernelLevel(KernelLevel level);
+KernelLevel GetSupportedKernelLevel();
+const char* GetKernelLevelName(KernelLevel level);
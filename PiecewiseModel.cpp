@@ -0,0 +1,223 @@
+#include "PiecewiseModel.h"
+#include <fstream>
+#include <climits>
+#include <cstring>
+
+//this file handles the piecewise constant model of a solved partitioning - lookups, range means, and the model file
+
+static const char modelMagic[8] = { 'G', 'R', 'I', 'D', 'M', 'D', 'L', '1' };
+static const unsigned int modelVersion = 1;
+static const size_t modelHeaderSize = 24;
+//queries evaluated side by side - each step of their binary searches is one load per query, all independent of each other, so the
+//loads of a whole group are in flight at once instead of one query's waiting on the last
+static const int evaluateGroup = 16;
+
+PiecewiseModel::PiecewiseModel() {
+	numSegments = 0;
+	lines = nullptr;
+	means = nullptr;
+	errors = nullptr;
+	runningSums = nullptr;
+	counts = nullptr;
+}
+
+//take a partitioning and the mean, error and point count of each of its segments - returns false (see GetError) unless there is one
+//more segment than division lines and the lines are in increasing order
+bool PiecewiseModel::Assign(const vector<int>& newLines, const vector<double>& newMeans, const vector<double>& newErrors, const vector<int>& newCounts) {
+	Close();
+	size_t segments = newMeans.size();
+	if (newErrors.size() != segments || newCounts.size() != segments || newLines.size() + 1 != max(segments, static_cast<size_t>(1)) || segments > INT_MAX) {
+		error = "a model needs one mean, error and count for every segment, and one segment more than division lines";
+		return false;
+	}
+	for (size_t s = 1; s < newLines.size(); s++) {
+		if (newLines[s] <= newLines[s - 1]) {
+			error = "division lines have to be in increasing order";
+			return false;
+		}
+	}
+	//the running sum of segment s is the sum of the model's value over every x before the segment starts, counting x from 1
+	ownedDoubles.resize(segments * 3);
+	copy(newMeans.begin(), newMeans.end(), ownedDoubles.begin());
+	copy(newErrors.begin(), newErrors.end(), ownedDoubles.begin() + segments);
+	double running = 0.0; int start = 1;
+	for (size_t s = 0; s < segments; s++) {
+		ownedDoubles[2 * segments + s] = running;
+		if (s + 1 < segments) {
+			running += newMeans[s] * (static_cast<double>(newLines[s]) - start);
+			start = newLines[s];
+		}
+	}
+	ownedInts.resize(segments + newLines.size());
+	copy(newCounts.begin(), newCounts.end(), ownedInts.begin());
+	copy(newLines.begin(), newLines.end(), ownedInts.begin() + segments);
+	PointAtColumns(reinterpret_cast<const char*>(ownedDoubles.data()), reinterpret_cast<const char*>(ownedInts.data()), static_cast<int>(segments));
+	return true;
+}
+
+//map a model file and use its columns in place - returns false (see GetError) if it can't be opened or isn't a valid model file
+//only the division lines are checked (they have to be in order for the lookups to work), so opening costs nothing per point
+bool PiecewiseModel::Open(const string& path) {
+	Close();
+	if (!file.Map(path, error)) return false;
+	const char* data = file.GetData();
+	size_t size = file.GetSize();
+	unsigned int version = 0; unsigned long long segments = 0;
+	if (size >= modelHeaderSize) {
+		memcpy(&version, data + 8, sizeof(version));
+		memcpy(&segments, data + 16, sizeof(segments));
+	}
+	if (size < modelHeaderSize || memcmp(data, modelMagic, 8) != 0 || version != modelVersion) {
+		error = path + " is not a model file";
+		Unmap();
+		return false;
+	}
+	unsigned long long numLines = (segments > 0) ? segments - 1 : 0;
+	if (segments > static_cast<unsigned long long>(INT_MAX) || size < modelHeaderSize + segments * 3 * sizeof(double) + (segments + numLines) * sizeof(int)) {
+		error = path + " is shorter than its segment count says";
+		Unmap();
+		return false;
+	}
+	const char* doubles = data + modelHeaderSize;
+	const char* ints = doubles + segments * 3 * sizeof(double);
+	PointAtColumns(doubles, ints, static_cast<int>(segments));
+	for (int s = 1; s < numSegments - 1; s++) {
+		if (lines[s] <= lines[s - 1]) {
+			error = path + " has division lines out of order at index " + to_string(s);
+			Unmap();
+			return false;
+		}
+	}
+	error.clear();
+	return true;
+}
+
+//write the model as a model file, to be loaded again with Open
+bool PiecewiseModel::Save(const string& path) const {
+	ofstream out(path, ios::binary | ios::trunc);
+	if (!out) return false;
+	unsigned int reserved = 0; unsigned long long segments = static_cast<unsigned long long>(numSegments);
+	out.write(modelMagic, 8);
+	out.write(reinterpret_cast<const char*>(&modelVersion), sizeof(modelVersion));
+	out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+	out.write(reinterpret_cast<const char*>(&segments), sizeof(segments));
+	if (numSegments > 0) {
+		out.write(reinterpret_cast<const char*>(means), numSegments * sizeof(double));
+		out.write(reinterpret_cast<const char*>(errors), numSegments * sizeof(double));
+		out.write(reinterpret_cast<const char*>(runningSums), numSegments * sizeof(double));
+		out.write(reinterpret_cast<const char*>(counts), numSegments * sizeof(int));
+		out.write(reinterpret_cast<const char*>(lines), (numSegments - 1) * sizeof(int));
+	}
+	return static_cast<bool>(out.flush());
+}
+
+void PiecewiseModel::Close() {
+	Unmap();
+	ownedDoubles.clear();
+	ownedInts.clear();
+	error.clear();
+}
+
+//release a mapped model file, leaving any error message in place
+void PiecewiseModel::Unmap() {
+	file.Unmap();
+	PointAtColumns(nullptr, nullptr, 0);
+}
+
+//point the columns at the model's data, laid out the same in memory as in a model file: means, errors and running sums back to back,
+//then counts and division lines
+void PiecewiseModel::PointAtColumns(const char* doubles, const char* ints, int newNumSegments) {
+	numSegments = newNumSegments;
+	if (numSegments == 0) doubles = ints = nullptr;
+	means = reinterpret_cast<const double*>(doubles);
+	errors = (doubles) ? means + numSegments : nullptr;
+	runningSums = (doubles) ? errors + numSegments : nullptr;
+	counts = reinterpret_cast<const int*>(ints);
+	lines = (ints) ? counts + numSegments : nullptr;
+}
+
+//the segment x falls in - the number of division lines at or before x
+//the binary search has no branches: every step moves the start of the range by half or not at all, so its length only depends on
+//the number of lines, never on x, and there is nothing to mispredict
+int PiecewiseModel::FindSegment(int x) const {
+	int numLines = numSegments - 1;
+	if (numLines <= 0) return 0;
+	const int* base = lines;
+	int remaining = numLines;
+	while (remaining > 1) {
+		int half = remaining / 2;
+		base = (base[half] <= x) ? base + half : base;
+		remaining -= half;
+	}
+	return static_cast<int>(base - lines) + (*base <= x);
+}
+
+//the model's approximation of y at x
+double PiecewiseModel::Evaluate(int x) const {
+	return (numSegments > 0) ? means[FindSegment(x)] : 0.0;
+}
+
+//the model's approximation of y at each of count x values, written to y
+//the same search as FindSegment, run for a group of queries at a time in lock step - every query takes the same number of steps
+void PiecewiseModel::Evaluate(const int* x, double* y, size_t count) const {
+	int numLines = numSegments - 1;
+	if (numLines <= 0) {
+		fill(y, y + count, (numSegments > 0) ? means[0] : 0.0);
+		return;
+	}
+	int at[evaluateGroup];
+	size_t i = 0;
+	for (; i + evaluateGroup <= count; i += evaluateGroup) {
+		for (int q = 0; q < evaluateGroup; q++) at[q] = 0;
+		for (int remaining = numLines; remaining > 1; ) {
+			int half = remaining / 2;
+			for (int q = 0; q < evaluateGroup; q++) at[q] += (lines[at[q] + half] <= x[i + q]) ? half : 0;
+			remaining -= half;
+		}
+		for (int q = 0; q < evaluateGroup; q++) y[i + q] = means[at[q] + (lines[at[q]] <= x[i + q])];
+	}
+	for (; i < count; i++) y[i] = means[FindSegment(x[i])];
+}
+
+//the mean of the model's value over every whole x from firstX to lastX - the running sums give the sum of the value over all x before
+//the start of any segment in constant time, so this is two segment lookups (O(log k) each) whatever the length of the range
+double PiecewiseModel::RangeMean(int firstX, int lastX) const {
+	if (numSegments == 0) return 0.0;
+	if (firstX > lastX) swap(firstX, lastX);
+	int first = FindSegment(firstX); int last = FindSegment(lastX);
+	double firstStart = (first == 0) ? 1.0 : lines[first - 1];
+	double lastStart = (last == 0) ? 1.0 : lines[last - 1];
+	double before = runningSums[first] + (firstX - firstStart) * means[first];
+	double through = runningSums[last] + (lastX - lastStart + 1.0) * means[last];
+	return (through - before) / (static_cast<double>(lastX) - firstX + 1.0);
+}
+
+double PiecewiseModel::GetTotalError() const {
+	double total = 0.0;
+	for (int s = 0; s < numSegments; s++) total += errors[s];
+	return total;
+}
+
+int PiecewiseModel::GetNumSegments() const {
+	return numSegments;
+}
+
+const int* PiecewiseModel::GetLines() const {
+	return lines;
+}
+
+const double* PiecewiseModel::GetMeans() const {
+	return means;
+}
+
+const double* PiecewiseModel::GetErrors() const {
+	return errors;
+}
+
+const int* PiecewiseModel::GetCounts() const {
+	return counts;
+}
+
+const string& PiecewiseModel::GetError() const {
+	return error;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "PointFile.h"
+
+using namespace std;
+
+//a solved partitioning kept as the piecewise constant function it stands for, in flat columns: segment s covers x from lines[s - 1]
+//(from 1 for the first segment) up to but not including lines[s] (through the largest x for the last), and approximates every y in
+//it by means[s], with errors[s] the squared error and counts[s] the number of points of the data it was fitted to
+//build one with Grid::FitModel, or load one with Open, which maps a saved model file and reads its columns in place
+//
+//model file (little endian):   8 bytes  "GRIDMDL1"
+//                              4 bytes  version (1)
+//                              4 bytes  reserved (0)
+//                              8 bytes  number of segments k
+//                              k * float64 means, k * float64 errors, k * float64 running sums of the model over x (see RangeMean)
+//                              k * int32 counts, (k - 1) * int32 division lines, in increasing order
+class PiecewiseModel {
+
+	void Unmap();
+	void PointAtColumns(const char* doubles, const char* ints, int newNumSegments);
+	int numSegments;
+	const int* lines;
+	const double* means;
+	const double* errors;
+	const double* runningSums;
+	const int* counts;
+	vector<double> ownedDoubles;
+	vector<int> ownedInts;
+	MappedFile file;
+	string error;
+
+public:
+	PiecewiseModel();
+	PiecewiseModel(const PiecewiseModel&) = delete;
+	PiecewiseModel& operator=(const PiecewiseModel&) = delete;
+	bool Assign(const vector<int>& newLines, const vector<double>& newMeans, const vector<double>& newErrors, const vector<int>& newCounts);
+	bool Open(const string& path);
+	bool Save(const string& path) const;
+	void Close();
+	int FindSegment(int x) const;
+	double Evaluate(int x) const;
+	void Evaluate(const int* x, double* y, size_t count) const;
+	double RangeMean(int firstX, int lastX) const;
+	double GetTotalError() const;
+	int GetNumSegments() const;
+	const int* GetLines() const;
+	const double* GetMeans() const;
+	const double* GetErrors() const;
+	const int* GetCounts() const;
+	const string& GetError() const;
+
+};
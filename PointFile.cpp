@@ -0,0 +1,435 @@
+#include "PointFile.h"
+#include <fstream>
+#include <cmath>
+#include <climits>
+#include <charconv>
+#include "ThreadPool.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//this file handles reading and writing the binary point and cut files described in PointFile.h, and the file mapping behind them
+
+static const char pointMagic[8] = { 'G', 'R', 'I', 'D', 'P', 'T', 'S', '1' };
+static const char cutMagic[8] = { 'G', 'R', 'I', 'D', 'C', 'U', 'T', '1' };
+static const unsigned int fileVersion = 1;
+static const size_t headerSize = 24;
+
+//the y column starts on the next multiple of 8 bytes after the x column, so it can be read in place as doubles
+static size_t YColumnOffset(size_t count) {
+	return headerSize + (count * sizeof(int) + 7) / 8 * 8;
+}
+
+static void WriteHeader(ofstream& out, const char* magic, unsigned long long count) {
+	unsigned int reserved = 0;
+	out.write(magic, 8);
+	out.write(reinterpret_cast<const char*>(&fileVersion), sizeof(fileVersion));
+	out.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+	out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+}
+
+MappedFile::MappedFile() {
+	data = nullptr;
+	size = 0;
+#ifdef _WIN32
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	descriptor = -1;
+#endif
+}
+
+MappedFile::~MappedFile() {
+	Unmap();
+}
+
+//map the whole of a file for reading - returns false, with a message in error, if it can't be opened, measured or mapped
+bool MappedFile::Map(const string& path, string& error) {
+	Unmap();
+#ifdef _WIN32
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		fileHandle = nullptr;
+		error = "could not open " + path;
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize)) {
+		error = "could not read the size of " + path;
+		Unmap();
+		return false;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+	if (size > 0) {
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle) data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		error = "could not open " + path;
+		return false;
+	}
+	struct stat status;
+	if (fstat(descriptor, &status) != 0) {
+		error = "could not read the size of " + path;
+		Unmap();
+		return false;
+	}
+	size = static_cast<size_t>(status.st_size);
+	if (size > 0) {
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if (mapped != MAP_FAILED) {
+			data = static_cast<const char*>(mapped);
+			madvise(mapped, size, MADV_SEQUENTIAL);
+		}
+	}
+#endif
+	if (size > 0 && !data) {
+		error = "could not map " + path;
+		Unmap();
+		return false;
+	}
+	return true;
+}
+
+//release the mapping and the file
+void MappedFile::Unmap() {
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	if (data) munmap(const_cast<char*>(data), size);
+	if (descriptor >= 0) close(descriptor);
+	descriptor = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+const char* MappedFile::GetData() const {
+	return data;
+}
+
+size_t MappedFile::GetSize() const {
+	return size;
+}
+
+PointFile::PointFile() {
+	numPoints = 0;
+	xColumn = nullptr;
+	yColumn = nullptr;
+}
+
+PointFile::~PointFile() {
+	Close();
+}
+
+//map a point file and check it can be solved as is - returns false (see GetError) if it can't be opened or isn't a valid point file
+//every point is checked once here (x at least 1, y a number, strictly increasing (x, y) order), which is the same rule AddPoint
+//enforces and means a solve can trust the columns without sorting or deduplicating them
+bool PointFile::Open(const string& path) {
+	Close();
+	if (!file.Map(path, error)) return false;
+	const char* data = file.GetData();
+	size_t size = file.GetSize();
+	if (size < headerSize) {
+		error = path + " is too short to be a point file";
+		Unmap();
+		return false;
+	}
+
+	unsigned int version = 0; unsigned long long count = 0;
+	memcpy(&version, data + 8, sizeof(version));
+	memcpy(&count, data + 16, sizeof(count));
+	if (memcmp(data, pointMagic, 8) != 0 || version != fileVersion) {
+		error = path + " is not a point file";
+		Unmap();
+		return false;
+	}
+	if (count > static_cast<unsigned long long>(INT_MAX) || size < YColumnOffset(static_cast<size_t>(count)) + count * sizeof(double)) {
+		error = path + " is shorter than its point count says";
+		Unmap();
+		return false;
+	}
+	numPoints = static_cast<int>(count);
+	xColumn = reinterpret_cast<const int*>(data + headerSize);
+	yColumn = reinterpret_cast<const double*>(data + YColumnOffset(static_cast<size_t>(count)));
+	for (int i = 0; i < numPoints; i++) {
+		if (xColumn[i] < 1 || isnan(yColumn[i]) || (i > 0 && (xColumn[i] < xColumn[i - 1] || (xColumn[i] == xColumn[i - 1] && yColumn[i] <= yColumn[i - 1])))) {
+			error = path + " has an invalid, out of order or duplicate point at index " + to_string(i);
+			Unmap();
+			return false;
+		}
+	}
+	error.clear();
+	return true;
+}
+
+void PointFile::Close() {
+	Unmap();
+	error.clear();
+}
+
+//release the mapping and the file, leaving any error message in place
+void PointFile::Unmap() {
+	file.Unmap();
+	numPoints = 0;
+	xColumn = nullptr;
+	yColumn = nullptr;
+}
+
+bool PointFile::IsOpen() const {
+	return file.GetData() != nullptr;
+}
+
+int PointFile::GetNumPoints() const {
+	return numPoints;
+}
+
+const int* PointFile::GetX() const {
+	return xColumn;
+}
+
+const double* PointFile::GetY() const {
+	return yColumn;
+}
+
+const string& PointFile::GetError() const {
+	return error;
+}
+
+PointFileReader::PointFileReader() {
+	numPoints = 0;
+	yOffset = 0;
+}
+
+//open a point file and read its header - returns false (see GetError) if it can't be opened or isn't a point file of the size its
+//header says
+bool PointFileReader::Open(const string& path) {
+	in.close();
+	in.clear();
+	numPoints = 0;
+	in.open(path, ios::binary | ios::ate);
+	if (!in) {
+		error = "could not open " + path;
+		return false;
+	}
+	size_t size = static_cast<size_t>(in.tellg());
+	char header[headerSize] = {};
+	in.seekg(0);
+	in.read(header, headerSize);
+	unsigned int version = 0; unsigned long long count = 0;
+	memcpy(&version, header + 8, sizeof(version));
+	memcpy(&count, header + 16, sizeof(count));
+	if (!in || memcmp(header, pointMagic, 8) != 0 || version != fileVersion) {
+		error = path + " is not a point file";
+		in.close();
+		return false;
+	}
+	if (size < YColumnOffset(static_cast<size_t>(count)) + count * sizeof(double)) {
+		error = path + " is shorter than its point count says";
+		in.close();
+		return false;
+	}
+	numPoints = static_cast<size_t>(count);
+	yOffset = YColumnOffset(numPoints);
+	error.clear();
+	return true;
+}
+
+//read the x values of points first..first+count-1
+bool PointFileReader::ReadX(size_t first, size_t count, int* x) {
+	if (first + count > numPoints) {
+		error = "read past the last point";
+		return false;
+	}
+	in.seekg(static_cast<streamoff>(headerSize + first * sizeof(int)));
+	in.read(reinterpret_cast<char*>(x), static_cast<streamsize>(count * sizeof(int)));
+	if (!in) {
+		error = "could not read points " + to_string(first) + " to " + to_string(first + count);
+		in.clear();
+		return false;
+	}
+	return true;
+}
+
+//read points first..first+count-1 into points, checking them the same way PointFile::Open does
+bool PointFileReader::Read(size_t first, size_t count, vector<Grid::point>& points) {
+	points.resize(count);
+	vector<double> y(count);
+	vector<int> x(count);
+	if (!ReadX(first, count, x.data())) return false;
+	in.seekg(static_cast<streamoff>(yOffset + first * sizeof(double)));
+	in.read(reinterpret_cast<char*>(y.data()), static_cast<streamsize>(count * sizeof(double)));
+	if (!in) {
+		error = "could not read points " + to_string(first) + " to " + to_string(first + count);
+		in.clear();
+		return false;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (x[i] < 1 || isnan(y[i]) || (i > 0 && (x[i] < x[i - 1] || (x[i] == x[i - 1] && y[i] <= y[i - 1])))) {
+			error = "invalid, out of order or duplicate point at index " + to_string(first + i);
+			return false;
+		}
+		points[i] = Grid::point(x[i], y[i]);
+	}
+	return true;
+}
+
+size_t PointFileReader::GetNumPoints() const {
+	return numPoints;
+}
+
+const string& PointFileReader::GetError() const {
+	return error;
+}
+
+//what one chunk of a text file parsed into - the line numbers of an error are counted from the start of the chunk
+struct textChunk {
+	const char* begin;
+	const char* end;
+	vector<Grid::point> points;
+	int lines = 0;
+	int errorLine = 0;
+	string error;
+};
+
+//parse one "x,y" line (without its line end) - from_chars reads both numbers in place, with no copies into strings on the way
+static bool ParsePointLine(const char* begin, const char* end, Grid::point& parsed) {
+	const char* comma = static_cast<const char*>(memchr(begin, ',', end - begin));
+	if (!comma || comma == begin || *begin < '0' || *begin > '9') return false;
+	from_chars_result result = from_chars(begin, comma, parsed.x);
+	if (result.ec != errc() || result.ptr != comma || parsed.x < 1) return false;
+	//from_chars would also take "inf" and "nan", so the y value has to start like a plain decimal number
+	const char* y = comma + 1;
+	const char* digits = (y < end && *y == '-') ? y + 1 : y;
+	if (digits == end || !((*digits >= '0' && *digits <= '9') || *digits == '.')) return false;
+	result = from_chars(y, end, parsed.y, chars_format::fixed);
+	return result.ec == errc() && result.ptr == end;
+}
+
+static void ParseTextChunk(textChunk& chunk) {
+	Grid::point parsed = {};
+	const char* line = chunk.begin;
+	while (line < chunk.end) {
+		const char* lineEnd = static_cast<const char*>(memchr(line, '\n', chunk.end - line));
+		if (!lineEnd) lineEnd = chunk.end;
+		const char* next = (lineEnd < chunk.end) ? lineEnd + 1 : chunk.end;
+		if (lineEnd > line && lineEnd[-1] == '\r') lineEnd--;
+		chunk.lines++;
+		if (lineEnd > line) {
+			if (!ParsePointLine(line, lineEnd, parsed)) {
+				chunk.errorLine = chunk.lines;
+				chunk.error = "'" + string(line, lineEnd - line) + "' is not a point x,y with x a positive integer and y a real number";
+				return;
+			}
+			chunk.points.push_back(parsed);
+		}
+		line = next;
+	}
+}
+
+bool ParsePointText(const char* text, size_t length, vector<Grid::point>& points, string& error, int threads) {
+	points.clear();
+	//below about a megabyte per thread, starting the threads costs more than the parsing
+	const size_t minimumChunkSize = 1 << 20;
+	size_t numChunks = max<size_t>(1, min<size_t>(max(threads, 1), length / minimumChunkSize));
+	vector<textChunk> chunks(numChunks);
+	const char* end = text + length;
+	const char* begin = text;
+	for (size_t c = 0; c < numChunks; c++) {
+		//every chunk but the last runs up to just past a line end, so no line is ever split between two chunks
+		const char* chunkEnd = (c + 1 == numChunks) ? end : text + length / numChunks * (c + 1);
+		if (chunkEnd < begin) chunkEnd = begin;
+		const char* lineEnd = (chunkEnd < end) ? static_cast<const char*>(memchr(chunkEnd, '\n', end - chunkEnd)) : nullptr;
+		chunkEnd = (c + 1 == numChunks || !lineEnd) ? end : lineEnd + 1;
+		chunks[c].begin = begin;
+		chunks[c].end = chunkEnd;
+		chunks[c].points.reserve((chunkEnd - begin) / 8);
+		begin = chunkEnd;
+	}
+	if (numChunks == 1) ParseTextChunk(chunks[0]);
+	else {
+		ThreadPool pool(static_cast<int>(numChunks));
+		pool.Run(static_cast<int>(numChunks), [&chunks](int c) { ParseTextChunk(chunks[c]); });
+	}
+
+	size_t total = 0; int lines = 0;
+	for (size_t c = 0; c < numChunks; c++) {
+		if (!chunks[c].error.empty()) {
+			error = "line " + to_string(lines + chunks[c].errorLine) + ": " + chunks[c].error;
+			return false;
+		}
+		lines += chunks[c].lines;
+		total += chunks[c].points.size();
+	}
+	points.reserve(total);
+	for (size_t c = 0; c < numChunks; c++) points.insert(points.end(), chunks[c].points.begin(), chunks[c].points.end());
+	error.clear();
+	return true;
+}
+
+//read a whole text point file in one go and parse it - the result is meant for a single Grid::AddPoints call
+bool ReadPointText(const string& path, vector<Grid::point>& points, string& error, int threads) {
+	points.clear();
+	ifstream in(path, ios::binary | ios::ate);
+	if (!in) {
+		error = "could not open " + path;
+		return false;
+	}
+	string text(static_cast<size_t>(in.tellg()), '\0');
+	in.seekg(0);
+	if (!in.read(&text[0], text.size())) {
+		error = "could not read " + path;
+		return false;
+	}
+	return ParsePointText(text.data(), text.size(), points, error, threads);
+}
+
+//write points as a point file - they are sorted and deduplicated on the way out, so any set of valid points gives an openable file
+//returns false if a point has x below 1 or y not a number, or the file couldn't be written
+bool WritePointFile(const string& path, const Grid::point* points, size_t count) {
+	vector<Grid::point> sorted(points, points + count);
+	for (size_t i = 0; i < count; i++) {
+		if (sorted[i].x < 1 || isnan(sorted[i].y)) return false;
+	}
+	sort(sorted.begin(), sorted.end(), [](const Grid::point& a, const Grid::point& b) { return (a.x != b.x) ? a.x < b.x : a.y < b.y; });
+	sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+	if (sorted.size() > static_cast<size_t>(INT_MAX)) return false;
+
+	ofstream out(path, ios::binary | ios::trunc);
+	if (!out) return false;
+	WriteHeader(out, pointMagic, sorted.size());
+	vector<int> xs(sorted.size()); vector<double> ys(sorted.size());
+	for (size_t i = 0; i < sorted.size(); i++) {
+		xs[i] = sorted[i].x;
+		ys[i] = sorted[i].y;
+	}
+	out.write(reinterpret_cast<const char*>(xs.data()), xs.size() * sizeof(int));
+	char padding[8] = {};
+	out.write(padding, YColumnOffset(sorted.size()) - headerSize - xs.size() * sizeof(int));
+	out.write(reinterpret_cast<const char*>(ys.data()), ys.size() * sizeof(double));
+	return static_cast<bool>(out.flush());
+}
+
+bool WritePointFile(const string& path, const vector<Grid::point>& points) {
+	return WritePointFile(path, points.data(), points.size());
+}
+
+//write the division lines of a partitioning (as returned by Grid::FindOptimalPartitionLines) as a cut file
+bool WriteCutFile(const string& path, const vector<int>& partitionLines) {
+	ofstream out(path, ios::binary | ios::trunc);
+	if (!out) return false;
+	WriteHeader(out, cutMagic, partitionLines.size());
+	out.write(reinterpret_cast<const char*>(partitionLines.data()), partitionLines.size() * sizeof(int));
+	return static_cast<bool>(out.flush());
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include "Grid.h"
+
+using namespace std;
+
+//a whole file mapped read only into memory - the point file and the model file (PiecewiseModel.h) are both read through one
+//a file of size 0 maps fine, with no data
+class MappedFile {
+
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int descriptor;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	bool Map(const string& path, string& error);
+	void Unmap();
+	const char* GetData() const;
+	size_t GetSize() const;
+
+};
+
+//binary point files - a columnar layout that can be memory mapped and handed to Grid as is, with no parsing and no copy
+//
+//point file (little endian):   8 bytes  "GRIDPTS1"
+//                              4 bytes  version (1)
+//                              4 bytes  reserved (0)
+//                              8 bytes  number of points n
+//                              n * int32 x column, zero padded to a multiple of 8 bytes
+//                              n * float64 y column
+//the points are stored sorted by x, then y, with no duplicates - the order Grid solves in - so a mapped file is ready to solve
+//
+//cut file (little endian):     8 bytes  "GRIDCUT1", 4 bytes version (1), 4 bytes reserved (0), 8 bytes number of division lines k
+//                              k * int32 division lines, in increasing order
+class PointFile {
+
+	void Unmap();
+	MappedFile file;
+	int numPoints;
+	const int* xColumn;
+	const double* yColumn;
+	string error;
+
+public:
+	PointFile();
+	~PointFile();
+	PointFile(const PointFile&) = delete;
+	PointFile& operator=(const PointFile&) = delete;
+	bool Open(const string& path);
+	void Close();
+	bool IsOpen() const;
+	int GetNumPoints() const;
+	const int* GetX() const;
+	const double* GetY() const;
+	const string& GetError() const;
+
+};
+
+//reads ranges of a point file with ordinary file reads instead of mapping it, so a file of any size (including more points than a
+//Grid can hold at once) can be worked through a piece at a time in a fixed amount of memory - the out of core solver reads its
+//chunks through one of these per thread. only the header is checked when opening; Read checks the points it reads
+class PointFileReader {
+
+	ifstream in;
+	size_t numPoints;
+	size_t yOffset;
+	string error;
+
+public:
+	PointFileReader();
+	bool Open(const string& path);
+	bool ReadX(size_t first, size_t count, int* x);
+	bool Read(size_t first, size_t count, vector<Grid::point>& points);
+	size_t GetNumPoints() const;
+	const string& GetError() const;
+
+};
+
+//text point files - one "x,y" point per line, x a positive integer and y a real number with no exponent (the rule the menu program
+//applies to typed points); blank lines and \r\n line ends are fine. Anything else fails the whole read with the line number in error
+//the text is split at line ends into one chunk per thread and the chunks are parsed side by side, then joined in file order
+bool ParsePointText(const char* text, size_t length, vector<Grid::point>& points, string& error, int threads = 1);
+bool ReadPointText(const string& path, vector<Grid::point>& points, string& error, int threads = 1);
+
+bool WritePointFile(const string& path, const Grid::point* points, size_t count);
+bool WritePointFile(const string& path, const vector<Grid::point>& points);
+bool WriteCutFile(const string& path, const vector<int>& partitionLines);
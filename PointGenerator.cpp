@@ -0,0 +1,118 @@
+#include "PointGenerator.h"
+#include <cmath>
+#include "ThreadPool.h"
+
+//this file handles making reproducible synthetic point sets
+
+//every point takes its draws from counters 4i..4i+3; the planted changepoints and levels count down from the top of the counter
+//range instead, so the two never meet
+static const unsigned long long drawsPerPoint = 4;
+static const unsigned long long setupCounter = ~0ULL;
+//below this many points a set is made in one pass - starting threads would cost more than it saves
+static const size_t parallelPoints = 65536;
+
+PointGenerator::PointGenerator(unsigned long long newSeed, Shape newShape, int newMaxX, int changepoints) {
+	seed = newSeed;
+	shape = newShape;
+	maxX = max(newMaxX, 1);
+	if (shape != Shape::Steps) return;
+	changepoints = max(changepoints, 0);
+	unsigned long long counter = setupCounter;
+	for (int i = 0; i < changepoints; i++) changes.push_back(DrawX(counter--));
+	sort(changes.begin(), changes.end());
+	for (int i = 0; i <= changepoints; i++) levels.push_back((2.0 * UnitDraw(counter--) - 1.0) * maxX);
+}
+
+//the counter-th 64 random bits of the seed's stream - SplitMix64's output function applied to seed-dependent start + counter * gamma
+unsigned long long PointGenerator::Draw(unsigned long long counter) const {
+	unsigned long long z = seed * 0xD1B54A32D192ED03ULL + counter * 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+//uniform double in [0,1) from the top 53 bits of one draw - done by hand rather than with <random>'s distributions, whose output is
+//allowed to differ between standard libraries
+double PointGenerator::UnitDraw(unsigned long long counter) const {
+	return static_cast<double>(Draw(counter) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int PointGenerator::DrawX(unsigned long long counter) const {
+	return 1 + static_cast<int>(Draw(counter) % static_cast<unsigned long long>(maxX));
+}
+
+//point number index of the set - the same whichever other points are made, and in whatever order
+Grid::point PointGenerator::GeneratePoint(size_t index) const {
+	unsigned long long counter = static_cast<unsigned long long>(index) * drawsPerPoint;
+	if (shape == Shape::Steps) {
+		int x = DrawX(counter);
+		int step = static_cast<int>(upper_bound(changes.begin(), changes.end(), x) - changes.begin());
+		//near normal noise with unit variance: the sum of six uniform 32 bit values (the two halves of each of three draws), shifted to mean
+		//0 and scaled by sqrt(12/6) - only integer sums and exactly rounded double operations, so unlike log and cos it can't differ
+		//between C libraries
+		unsigned long long sum = 0;
+		for (int d = 1; d <= 3; d++) {
+			unsigned long long bits = Draw(counter + d);
+			sum += (bits & 0xFFFFFFFFULL) + (bits >> 32);
+		}
+		double noise = ((static_cast<double>(sum) + 3.0) / 4294967296.0 - 3.0) * 1.4142135623730950488;
+		return Grid::point(x, levels[step] + noise);
+	}
+	int x = 0;
+	if (shape == Shape::Collisions) {
+		long long distinct = max(1, static_cast<int>(sqrt(static_cast<double>(maxX))));
+		long long slot = static_cast<long long>(Draw(counter) % static_cast<unsigned long long>(distinct));
+		x = 1 + static_cast<int>(slot * maxX / distinct);
+	}
+	else x = DrawX(counter);
+	return Grid::point(x, (2.0 * UnitDraw(counter + 1) - 1.0) * maxX);
+}
+
+//points first..first+count-1 of the set, written to points - with more than one thread, each makes one contiguous shard
+void PointGenerator::Generate(size_t first, size_t count, Grid::point* points, int threads) const {
+	if (threads <= 1 || count < parallelPoints) {
+		Generate(first, count, points, nullptr);
+		return;
+	}
+	ThreadPool pool(threads);
+	Generate(first, count, points, &pool);
+}
+
+//same as above, shared out over an existing pool (or made in one pass if pool is null) - for callers like Grid that keep a pool
+//of their own, so no threads are started here
+void PointGenerator::Generate(size_t first, size_t count, Grid::point* points, ThreadPool* pool) const {
+	int threads = (pool && count >= parallelPoints) ? pool->GetNumThreads() : 1;
+	if (threads <= 1) {
+		for (size_t i = 0; i < count; i++) points[i] = GeneratePoint(first + i);
+		return;
+	}
+	pool->Run(threads, [&](int t) {
+		size_t begin = count * t / threads;
+		size_t end = count * (t + 1) / threads;
+		for (size_t i = begin; i < end; i++) points[i] = GeneratePoint(first + i);
+	});
+}
+
+//the first count points of the set
+vector<Grid::point> PointGenerator::Generate(size_t count, int threads) const {
+	vector<Grid::point> points(count);
+	Generate(0, count, points.data(), threads);
+	return points;
+}
+
+unsigned long long PointGenerator::GetSeed() const {
+	return seed;
+}
+
+PointGenerator::Shape PointGenerator::GetShape() const {
+	return shape;
+}
+
+int PointGenerator::GetMaxX() const {
+	return maxX;
+}
+
+//where the Steps shape changes level, in increasing order (empty for the other shapes)
+const vector<int>& PointGenerator::GetChangepoints() const {
+	return changes;
+}
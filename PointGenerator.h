@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "Grid.h"
+
+using namespace std;
+
+//seeded synthetic point sets for experiments, the same on every machine, compiler and thread count
+//the generator is counter based: point i is worked out from the seed and i alone (a SplitMix64 style mix of seed + i * constant),
+//with no state carried from one point to the next - so any range of points can be made on its own, a set split into shards across
+//threads comes out exactly the same as one made in a single pass, and a bigger set starts with the points of a smaller one
+//shapes:  Uniform     - x uniform in [1,m], y uniform in [-m,m] (the same shape as Grid::AddRandomPoints)
+//         Steps       - piecewise constant y with changepoints planted at random x values, plus near gaussian noise with unit
+//                       variance (a scaled sum of six uniform draws)
+//         Collisions  - x drawn from only sqrt(m) distinct values, so most points share an x with many others
+//every value is made with integer arithmetic and exactly rounded double operations only (no log, cos or other C library maths,
+//whose last bits can differ between platforms)
+//y values are full 53 bit doubles (Steps noise has over 32 bits), so a repeated point is rare - Grid::AddPoints and AddRandomPoints drop any that do turn up
+class PointGenerator {
+public:
+	enum class Shape { Uniform, Steps, Collisions };
+
+private:
+	unsigned long long Draw(unsigned long long counter) const;
+	double UnitDraw(unsigned long long counter) const;
+	int DrawX(unsigned long long counter) const;
+	unsigned long long seed;
+	Shape shape;
+	int maxX;
+	vector<int> changes;
+	vector<double> levels;
+
+public:
+	PointGenerator(unsigned long long newSeed = 1, Shape newShape = Shape::Uniform, int newMaxX = 5000, int changepoints = 20);
+	Grid::point GeneratePoint(size_t index) const;
+	void Generate(size_t first, size_t count, Grid::point* points, int threads = 1) const;
+	void Generate(size_t first, size_t count, Grid::point* points, ThreadPool* pool) const;
+	vector<Grid::point> Generate(size_t count, int threads = 1) const;
+	unsigned long long GetSeed() const;
+	Shape GetShape() const;
+	int GetMaxX() const;
+	const vector<int>& GetChangepoints() const;
+
+};
@@ -0,0 +1,191 @@
+#include "StreamingGrid.h"
+
+//this file handles the online version of the binned method: points arrive one at a time in nondecreasing x order, and each new
+//bin only costs one step of the pruned Bellman equation, so a new point takes the same time however much history came before it
+
+//the penalty is fixed for the life of the stream, since every stored OPT value depends on it
+//a window width of 0 keeps every point; otherwise only the last newWindowWidth x units are kept, and every buffer is sized up front
+StreamingGrid::StreamingGrid(double newPenalty, int newWindowWidth) {
+	penalty = newPenalty;
+	shift = 0.0;
+	numPoints = 0;
+	openBin = false;
+	openX = 0;
+	binCount = 0;
+	windowWidth = (newWindowWidth > 0) ? newWindowWidth : 0;
+	windowStart = 0;
+	windowSize = 0;
+	if (windowWidth > 0) {
+		//a window of w x units never holds more than w bins, plus one for the empty prefix
+		window.resize(windowWidth);
+		binX.reserve(windowWidth); binEnd.reserve(windowWidth + 1);
+		sumY.reserve(windowWidth + 1); sumYSquare.reserve(windowWidth + 1);
+		OPT.reserve(windowWidth + 1); lastSegmentStart.reserve(windowWidth + 1);
+		candidates.reserve(windowWidth); candidateCosts.reserve(windowWidth);
+		partitionLines.reserve(windowWidth);
+	}
+	binEnd.push_back(0);
+	sumY.push_back(0.0);
+	sumYSquare.push_back(0.0);
+	OPT.push_back(0.0);
+	lastSegmentStart.push_back(0);
+}
+
+//add the next point of the stream - x must not be smaller than any x already added, and duplicate points are ignored like in Grid
+//returns false if the point was rejected
+bool StreamingGrid::AddPoint(int x, double y) {
+	if (x < 1 || (openBin && x < openX)) return false;
+	if (openBin && x == openX && !openYs.insert(y).second) return false;
+	if (!openBin || x != openX) {
+		if (openBin) CloseBin();
+		//the first y stands in for the mean when shifting values before summing (see Grid::PrecomputeErrorSums)
+		if (numPoints == 0) shift = y;
+		openBin = true;
+		openX = x;
+		openYs.clear();
+		openYs.insert(y);
+		binY = CompensatedSum(); binYSquare = CompensatedSum(); binCount = 0;
+		if (windowWidth > 0) EvictBefore(x - windowWidth + 1);
+	}
+	if (windowWidth > 0) {
+		binY.Add(y - shift);
+		binYSquare.Add((y - shift) * (y - shift));
+		binCount++;
+	}
+	else {
+		runningY.Add(y - shift);
+		runningYSquare.Add((y - shift) * (y - shift));
+	}
+	numPoints++;
+	return true;
+}
+
+//drop every bin in the ring buffer with an x below firstX - the oldest bins sit at windowStart
+void StreamingGrid::EvictBefore(int firstX) {
+	while (windowSize > 0 && window[windowStart].x < firstX) {
+		windowStart = (windowStart + 1) % windowWidth;
+		windowSize--;
+	}
+}
+
+//the bin at openX won't get any more points - store its prefix sums and solve OPT for it
+//in windowed mode the bin's totals just go into the ring buffer, and OPT waits until the partitioning is asked for
+void StreamingGrid::CloseBin() {
+	openBin = false;
+	if (windowWidth > 0) {
+		window[(windowStart + windowSize) % windowWidth] = { openX, binCount, binY.Total(), binYSquare.Total() };
+		windowSize++;
+		return;
+	}
+	binX.push_back(openX);
+	binEnd.push_back(numPoints);
+	sumY.push_back(runningY.Total());
+	sumYSquare.push_back(runningYSquare.Total());
+	OPT.push_back(0.0);
+	lastSegmentStart.push_back(0);
+	SolveBin(static_cast<int>(binX.size()), true);
+}
+
+//one step of the pruned Bellman equation (same as Grid::SolvePruned) for the first b bins
+//with prune set, starts that can never win again are dropped and b joins the candidates - a tentative step leaves them alone
+double StreamingGrid::SolveBin(int b, bool prune) {
+	double minimumVal = Error(0, b);
+	int tempPartitioning = 0;
+	double tempMinimum = minimumVal + OPT[0] + penalty;
+	if (tempMinimum <= minimumVal) minimumVal = tempMinimum;
+	candidateCosts.resize(candidates.size());
+	for (size_t c = 0; c < candidates.size(); c++) {
+		candidateCosts[c] = Error(candidates[c], b) + OPT[candidates[c]];
+		tempMinimum = candidateCosts[c] + penalty;
+		if (tempMinimum <= minimumVal) {
+			minimumVal = tempMinimum;
+			tempPartitioning = candidates[c];
+		}
+	}
+	OPT[b] = minimumVal;
+	lastSegmentStart[b] = tempPartitioning;
+	if (prune) {
+		size_t kept = 0;
+		for (size_t c = 0; c < candidates.size(); c++) {
+			if (candidateCosts[c] <= OPT[b]) candidates[kept++] = candidates[c];
+		}
+		candidates.resize(kept);
+		candidates.push_back(b);
+	}
+	return minimumVal;
+}
+
+//same error as Grid::CalculateBinnedError, over bins b1+1..b2
+double StreamingGrid::Error(int b1, int b2) {
+	int pointsInCell = binEnd[b2] - binEnd[b1];
+	double sumYInCell = (sumY[b2] - sumY[b1]);
+	double average = (pointsInCell == 0) ? 0 : sumYInCell / pointsInCell;
+	double error = (sumYSquare[b2] - sumYSquare[b1]) - pointsInCell * average * average;
+	return (error < 0) ? 0 : error;
+}
+
+//division lines of the optimal partitioning of every point added so far
+//the open bin is solved tentatively (without pruning) and then taken back off, so it can still receive points afterwards
+const vector<int>& StreamingGrid::GetPartitionLines() {
+	partitionLines.clear();
+	if (windowWidth > 0) {
+		SolveWindow();
+		return partitionLines;
+	}
+	int numBins = static_cast<int>(binX.size());
+	if (openBin) {
+		binX.push_back(openX);
+		binEnd.push_back(numPoints);
+		sumY.push_back(runningY.Total());
+		sumYSquare.push_back(runningYSquare.Total());
+		OPT.push_back(0.0);
+		lastSegmentStart.push_back(0);
+		numBins++;
+		SolveBin(numBins, false);
+	}
+	for (int b = numBins; lastSegmentStart[b] > 0; b = lastSegmentStart[b]) partitionLines.push_back(binX[lastSegmentStart[b]]);
+	reverse(partitionLines.begin(), partitionLines.end());
+	if (openBin) {
+		binX.pop_back(); binEnd.pop_back(); sumY.pop_back(); sumYSquare.pop_back(); OPT.pop_back(); lastSegmentStart.pop_back();
+	}
+	return partitionLines;
+}
+
+//partitioning of just the bins in the window (and the open bin): rebuild prefix sums from the ring buffer into the scratch arrays
+//and run the pruned Bellman equation over them - the work only depends on the window, and the arrays never grow past it
+void StreamingGrid::SolveWindow() {
+	binX.clear(); binEnd.assign(1, 0); sumY.assign(1, 0.0); sumYSquare.assign(1, 0.0);
+	OPT.assign(1, 0.0); lastSegmentStart.assign(1, 0); candidates.clear();
+	CompensatedSum prefixY; CompensatedSum prefixYSquare;
+	int numBins = windowSize + ((openBin) ? 1 : 0);
+	for (int b = 0; b < numBins; b++) {
+		binSums bin = (b < windowSize) ? window[(windowStart + b) % windowWidth] : binSums{ openX, binCount, binY.Total(), binYSquare.Total() };
+		prefixY.Add(bin.sumY);
+		prefixYSquare.Add(bin.sumYSquare);
+		binX.push_back(bin.x);
+		binEnd.push_back(binEnd.back() + bin.count);
+		sumY.push_back(prefixY.Total());
+		sumYSquare.push_back(prefixYSquare.Total());
+		OPT.push_back(0.0);
+		lastSegmentStart.push_back(0);
+		SolveBin(b + 1, true);
+	}
+	for (int b = numBins; lastSegmentStart[b] > 0; b = lastSegmentStart[b]) partitionLines.push_back(binX[lastSegmentStart[b]]);
+	reverse(partitionLines.begin(), partitionLines.end());
+}
+
+int StreamingGrid::GetWindowWidth() {
+	return windowWidth;
+}
+
+double StreamingGrid::GetPenalty() {
+	return penalty;
+}
+
+int StreamingGrid::GetNumPoints() {
+	return numPoints;
+}
+
+int StreamingGrid::GetMaxXVal() {
+	return (openBin) ? openX : (binX.empty() ? 1 : binX.back());
+}
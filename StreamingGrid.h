@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <unordered_set>
+#include "Grid.h"
+
+using namespace std;
+
+//online version of the binned pruned method in Grid - points are fed in nondecreasing x order and the optimal partitioning of
+//everything seen so far is kept up to date as they arrive, instead of being re-solved from scratch
+//every distinct x is one bin; a bin is closed (and its OPT worked out) as soon as a point with a larger x arrives
+//
+//with a window width set, only bins in the last windowWidth x units are kept, in a fixed size ring buffer, and the partitioning is
+//of the window alone - memory then stays the same however long the stream runs
+class StreamingGrid {
+
+	//totals of one closed bin, as kept in the window's ring buffer
+	struct binSums {
+		int x;
+		int count;
+		double sumY;
+		double sumYSquare;
+	};
+
+	double Error(int b1, int b2);
+	void CloseBin();
+	double SolveBin(int b, bool prune);
+	void EvictBefore(int x);
+	void SolveWindow();
+	double penalty;
+	double shift;
+	int numPoints;
+	//the bin still receiving points - its sums are kept as running totals until it's closed
+	bool openBin;
+	int openX;
+	unordered_set<double> openYs;
+	CompensatedSum runningY;
+	CompensatedSum runningYSquare;
+	CompensatedSum binY;
+	CompensatedSum binYSquare;
+	int binCount;
+	//ring buffer of the closed bins inside the window (windowed mode only)
+	int windowWidth;
+	vector<binSums> window;
+	int windowStart;
+	int windowSize;
+	//prefix sums and DP state for the closed bins, indexed like Grid's binned method (entry 0 = no bins)
+	//in windowed mode these are scratch space, rebuilt from the ring buffer whenever the partitioning is asked for
+	vector<int> binX;
+	vector<int> binEnd;
+	vector<double> sumY;
+	vector<double> sumYSquare;
+	vector<double> OPT;
+	vector<int> lastSegmentStart;
+	vector<int> candidates;
+	vector<double> candidateCosts;
+	vector<int> partitionLines;
+
+public:
+	StreamingGrid(double newPenalty = 10.0, int newWindowWidth = 0);
+	bool AddPoint(int x, double y);
+	const vector<int>& GetPartitionLines();
+	double GetPenalty();
+	int GetNumPoints();
+	int GetMaxXVal();
+	int GetWindowWidth();
+
+};
@@ -0,0 +1,75 @@
+#include "ThreadPool.h"
+
+//this file handles the worker threads shared by the parallel solvers
+
+ThreadPool::ThreadPool(int numThreads) {
+	job = nullptr;
+	jobTasks = 0;
+	nextTask = 0;
+	busyWorkers = 0;
+	generation = 0;
+	stopping = false;
+	for (int i = 1; i < numThreads; i++) workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> lock(jobMutex);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	for (unsigned int i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+//run task(0), task(1), ..., task(numTasks - 1) spread over the pool, and return once every one of them has finished
+//tasks are handed out one at a time from a shared counter, so uneven tasks still balance out
+void ThreadPool::Run(int numTasks, const function<void(int)>& task) {
+	if (numTasks <= 0) return;
+	//only one job at a time - grids sharing a pool from different threads simply take turns
+	lock_guard<mutex> runLock(runMutex);
+	if (workers.empty() || numTasks == 1) {
+		for (int i = 0; i < numTasks; i++) task(i);
+		return;
+	}
+	{
+		lock_guard<mutex> lock(jobMutex);
+		job = &task;
+		jobTasks = numTasks;
+		nextTask = 0;
+		busyWorkers = static_cast<int>(workers.size());
+		generation++;
+	}
+	jobReady.notify_all();
+	RunTasks();
+	//the job (and the task it points to) has to outlive every worker still inside it
+	unique_lock<mutex> lock(jobMutex);
+	jobDone.wait(lock, [this] { return busyWorkers == 0; });
+	job = nullptr;
+}
+
+//claim and run tasks of the current job until there are none left
+void ThreadPool::RunTasks() {
+	for (int i = nextTask++; i < jobTasks; i = nextTask++) (*job)(i);
+}
+
+void ThreadPool::WorkerLoop() {
+	unsigned long long seenGeneration = 0;
+	while (true) {
+		{
+			unique_lock<mutex> lock(jobMutex);
+			jobReady.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+			if (stopping) return;
+			seenGeneration = generation;
+		}
+		RunTasks();
+		{
+			lock_guard<mutex> lock(jobMutex);
+			busyWorkers--;
+		}
+		jobDone.notify_one();
+	}
+}
+
+int ThreadPool::GetNumThreads() {
+	return static_cast<int>(workers.size()) + 1;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+//a fixed set of worker threads that stay alive between jobs, so splitting a loop across threads doesn't pay for thread creation every time
+//the calling thread takes part in every job, so a pool of n threads only starts n-1 workers
+class ThreadPool {
+
+	void WorkerLoop();
+	void RunTasks();
+	vector<thread> workers;
+	mutex jobMutex;
+	mutex runMutex;
+	condition_variable jobReady;
+	condition_variable jobDone;
+	const function<void(int)>* job;
+	int jobTasks;
+	atomic<int> nextTask;
+	int busyWorkers;
+	unsigned long long generation;
+	bool stopping;
+
+public:
+	ThreadPool(int numThreads);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	void Run(int numTasks, const function<void(int)>& task);
+	int GetNumThreads();
+
+};